@@ -0,0 +1,756 @@
+#include <benchmark/benchmark.h>
+#include <apollo/apollo.h>
+#include <apollo/command/destroy_command.h>
+#include <apollo/command/remove_command.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <utility>
+#include "transform.h"
+#include "mass.h"
+#include "velocity.h"
+
+template <std::size_t I>
+struct tag : public apollo::component<tag<I>>
+{
+	int m_value = 0;
+};
+
+static void structural_args(benchmark::internal::Benchmark* b)
+{
+	for (int entities : { 1 << 10, 1 << 12, 1 << 14 })
+		for (int threads : { 1, 4 })
+			b->Args({ entities, threads });
+}
+
+static void iteration_args(benchmark::internal::Benchmark* b)
+{
+	for (int entities : { 1 << 10, 1 << 14, 1 << 18 })
+		for (int threads : { 1, 4 })
+			b->Args({ entities, threads });
+}
+
+static std::vector<apollo::entity> populate(apollo::registry& registry, const std::size_t count)
+{
+	std::vector<apollo::entity> entities;
+	entities.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 1.0f, 2.0f, 3.0f);
+		registry.emplace<velocity>(e, 1.0f);
+		registry.emplace<mass>(e, 1.0f);
+		entities.push_back(e);
+	}
+	return entities;
+}
+
+static std::vector<apollo::entity> shuffled(std::vector<apollo::entity> entities)
+{
+	std::shuffle(entities.begin(), entities.end(), std::mt19937(42));
+	return entities;
+}
+
+template <typename Fn>
+static void run_query(apollo::registry& registry, Fn&& fn)
+{
+	apollo::job dependency;
+	apollo::job query = registry.for_each(fn, dependency);
+	query.schedule().complete();
+}
+
+static void BM_create_destroy(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	std::vector<apollo::entity> entities(count);
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			entities[i] = registry.create();
+		for (std::size_t i = 0; i < count; ++i)
+			registry.destroy(entities[i]);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_create_destroy)->Apply(structural_args);
+
+static void BM_clear_loop(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::vector<apollo::entity> entities = populate(registry, count);
+		state.ResumeTiming();
+		for (apollo::entity& e : entities)
+			registry.destroy(e);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_clear_loop)->Apply(structural_args);
+
+static void BM_destroy_all(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		populate(registry, count);
+		state.ResumeTiming();
+		registry.destroy_all<transform>();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_destroy_all)->Apply(structural_args);
+
+static void BM_instantiate(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	apollo::prefab<transform, velocity, mass> unit(transform(1.0f, 2.0f, 3.0f), velocity(1.0f), mass(1.0f));
+	std::vector<apollo::entity> entities;
+	for (auto _ : state)
+	{
+		registry.instantiate(unit, count, entities);
+		state.PauseTiming();
+		registry.destroy_all<transform>();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_instantiate)->Apply(structural_args);
+
+static void BM_populate(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	for (auto _ : state)
+	{
+		populate(registry, count);
+		state.PauseTiming();
+		registry.destroy_all<transform>();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_populate)->Apply(structural_args);
+
+static void fill_commands(apollo::command_buffer& buffer, std::vector<apollo::entity>& entities)
+{
+	for (std::size_t i = 0; i < entities.size(); ++i)
+	{
+		if (i % 2)
+			buffer.add_command<apollo::remove_command<velocity>>(entities[i]);
+		else if (i % 4 == 0)
+			buffer.add_command<apollo::destroy_command>(entities[i]);
+		else
+			buffer.add_command<apollo::remove_command<mass>>(entities[i]);
+	}
+}
+
+static void BM_command_buffer_execute(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::vector<apollo::entity> entities = shuffled(populate(registry, count));
+		apollo::command_buffer buffer = registry.create_command_buffer();
+		fill_commands(buffer, entities);
+		state.ResumeTiming();
+		buffer.execute();
+		state.PauseTiming();
+		registry.destroy_all<transform>();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_command_buffer_execute)->Apply(structural_args);
+
+static void BM_registry_execute(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::vector<apollo::entity> entities = shuffled(populate(registry, count));
+		apollo::command_buffer buffer = registry.create_command_buffer();
+		fill_commands(buffer, entities);
+		state.ResumeTiming();
+		registry.execute(buffer);
+		state.PauseTiming();
+		registry.destroy_all<transform>();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_registry_execute)->Apply(structural_args);
+
+static void BM_emplace_single(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		apollo::registry registry(state.range(1));
+		std::vector<apollo::entity> entities(count);
+		for (std::size_t i = 0; i < count; ++i)
+			entities[i] = registry.create();
+		state.ResumeTiming();
+		for (std::size_t i = 0; i < count; ++i)
+			registry.emplace<transform>(entities[i], 1.0f, 2.0f, 3.0f);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_emplace_single)->Apply(structural_args);
+
+static void BM_emplace_multi(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		apollo::registry registry(state.range(1));
+		state.ResumeTiming();
+		benchmark::DoNotOptimize(populate(registry, count));
+	}
+	state.SetItemsProcessed(state.iterations() * count * 3);
+}
+BENCHMARK(BM_emplace_multi)->Apply(structural_args);
+
+static void BM_remove_single(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		apollo::registry registry(state.range(1));
+		auto entities = populate(registry, count);
+		state.ResumeTiming();
+		for (std::size_t i = 0; i < count; ++i)
+			registry.remove<mass>(entities[i]);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_remove_single)->Apply(structural_args);
+
+static void BM_remove_multi(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		apollo::registry registry(state.range(1));
+		auto entities = populate(registry, count);
+		state.ResumeTiming();
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			registry.remove<mass>(entities[i]);
+			registry.remove<velocity>(entities[i]);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * count * 2);
+}
+BENCHMARK(BM_remove_multi)->Apply(structural_args);
+
+static void BM_get_random(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	auto entities = shuffled(populate(registry, count));
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (apollo::entity e : entities)
+		{
+			auto [t, m] = registry.get<transform, mass>(e);
+			sum += t.m_x * m.m_mass;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_get_random)->Apply(structural_args);
+
+static void BM_get_random_sorted(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	registry.sort_by_entity<transform>();
+	auto entities = shuffled(populate(registry, count));
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (apollo::entity e : entities)
+		{
+			auto [t, m] = registry.get<transform, mass>(e);
+			sum += t.m_x * m.m_mass;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_get_random_sorted)->Apply(structural_args);
+
+static void BM_find_scan(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (apollo::entity e = 0; e < count; ++e)
+		registry.replace<mass>(e, static_cast<float>(e));
+	std::mt19937 rng(42);
+	for (auto _ : state)
+	{
+		const float key = static_cast<float>(rng() % count);
+		apollo::entity found = apollo::invalid_index;
+		run_query(registry, [&found, key](apollo::entity& e, const mass& m) {
+			if (m.m_mass == key)
+				found = e;
+		});
+		benchmark::DoNotOptimize(found);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_find_scan)->Apply(structural_args);
+
+static void BM_find_indexed(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (apollo::entity e = 0; e < count; ++e)
+		registry.replace<mass>(e, static_cast<float>(e));
+	auto& index = registry.index<apollo::hash_index<&mass::m_mass>>();
+	std::mt19937 rng(42);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(index.find(static_cast<float>(rng() % count)));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_find_indexed)->Apply(structural_args);
+
+// A system reacting to one percent of the world changing per frame.
+static void BM_changes_scan(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	std::mt19937 rng(42);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (std::size_t i = 0; i < count / 100; ++i)
+			registry.replace<mass>(rng() % count, 2.0f);
+		state.ResumeTiming();
+		float sum = 0.0f;
+		run_query(registry, [&sum](apollo::entity& e, const mass& m) {
+			sum += m.m_mass;
+		});
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_changes_scan)->Apply(structural_args);
+
+static void BM_changes_reactive(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	// entity lookups binary-search instead of scanning the archetype
+	registry.sort_by_entity<mass>();
+	populate(registry, count);
+	auto& changes = registry.create_reactive<mass>();
+	changes.collect();
+	std::mt19937 rng(42);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (std::size_t i = 0; i < count / 100; ++i)
+			registry.replace<mass>(rng() % count, 2.0f);
+		state.ResumeTiming();
+		float sum = 0.0f;
+		for (apollo::entity e : changes.collect())
+			sum += std::get<0>(registry.get<mass, mass>(e)).m_mass;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_changes_reactive)->Apply(structural_args);
+
+static void BM_entities_lookup(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	registry.sort_by_entity<transform>();
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (apollo::entity e : registry.get_entities<transform, velocity>())
+		{
+			auto [t, v] = registry.get<transform, velocity>(e);
+			sum += t.m_x * v.m_velocity;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_entities_lookup)->Apply(structural_args);
+
+static void BM_view(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (auto [e, t, v] : registry.view<transform, velocity>())
+			sum += t.m_x * v.m_velocity;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_view)->Apply(structural_args);
+
+static void BM_sum_locked(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		std::mutex mutex;
+		float total = 0.0f;
+		run_query(registry, [&mutex, &total](apollo::entity& e, const mass& m) {
+			std::lock_guard<std::mutex> lock(mutex);
+			total += m.m_mass;
+		});
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_sum_locked)->Apply(structural_args)->UseRealTime();
+
+static void BM_sum_reduce(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(registry.transform_reduce(0.0f, [](const apollo::entity& e, const mass& m) {
+			return m.m_mass;
+		}, [](const float lhs, const float rhs) {
+			return lhs + rhs;
+		}));
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_sum_reduce)->Apply(structural_args)->UseRealTime();
+
+// One in sixteen entities is active, the rest are idle and tagged; with range(1) set the idle
+// archetype is paged out to the cold store and queries only walk the active rows.
+static void BM_query_cold(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(1);
+	populate(registry, count);
+	for (apollo::entity e = 0; e < count; ++e)
+	{
+		if (e % 16)
+			registry.emplace<tag<0>>(e);
+	}
+	if (state.range(1))
+	{
+		registry.set_cold_store("bench_cold.bin");
+		registry.freeze<tag<0>>();
+	}
+	for (auto _ : state)
+	{
+		run_query(registry, [](apollo::entity& e, transform& t, const velocity& v) {
+			t.m_x += v.m_velocity;
+		});
+	}
+	state.counters["cold_bytes"] = static_cast<double>(registry.cold_size());
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_query_cold)->ArgsProduct({ { 1 << 14, 1 << 18 }, { 0, 1 } })->UseRealTime();
+
+static void BM_patch_random(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	auto entities = shuffled(populate(registry, count));
+	for (auto _ : state)
+	{
+		for (apollo::entity e : entities)
+		{
+			registry.patch(e, [](transform& t, velocity& v) {
+				t.m_x += v.m_velocity;
+			});
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_patch_random)->Apply(structural_args);
+
+static void BM_for_each_1(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		run_query(registry, [](apollo::entity& e, transform& t) {
+			t.m_x += 1.0f;
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_for_each_1)->Apply(iteration_args)->UseRealTime();
+
+static void BM_for_each_2(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		run_query(registry, [](apollo::entity& e, transform& t, velocity& v) {
+			t.m_x += v.m_velocity;
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_for_each_2)->Apply(iteration_args)->UseRealTime();
+
+static void BM_for_each_3(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		run_query(registry, [](apollo::entity& e, transform& t, velocity& v, mass& m) {
+			t.m_x += v.m_velocity / m.m_mass;
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_for_each_3)->Apply(iteration_args)->UseRealTime();
+
+static void BM_for_each_chunk_2(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::registry registry(state.range(1));
+	populate(registry, count);
+	for (auto _ : state)
+	{
+		apollo::job dependency;
+		apollo::job query = registry.for_each_chunk([](apollo::span<const apollo::entity> e, apollo::span<transform> t, apollo::span<const velocity> v) {
+			for (std::size_t i = 0; i < e.size(); ++i)
+				t[i].m_x += v[i].m_velocity;
+		}, dependency);
+		query.schedule().complete();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_for_each_chunk_2)->Apply(iteration_args)->UseRealTime();
+
+template <std::size_t... I>
+static void emplace_tags(apollo::registry& registry, apollo::entity e, const std::size_t mask, std::index_sequence<I...>)
+{
+	((mask & (std::size_t(1) << I) ? (void)registry.emplace<tag<I>>(e) : (void)0), ...);
+}
+
+static void BM_fragmentation(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	const std::size_t archetypes = state.range(1);
+	apollo::registry registry(4);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 1.0f, 2.0f, 3.0f);
+		emplace_tags(registry, e, i % archetypes, std::make_index_sequence<6>());
+	}
+	for (auto _ : state)
+	{
+		run_query(registry, [](apollo::entity& e, transform& t) {
+			t.m_x += 1.0f;
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+	state.counters["archetypes"] = static_cast<double>(archetypes);
+}
+BENCHMARK(BM_fragmentation)->ArgsProduct({ { 1 << 14 }, { 1, 4, 16, 64 } })->UseRealTime();
+
+static void BM_fragmentation_group(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	const std::size_t archetypes = state.range(1);
+	apollo::registry registry(4);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 1.0f, 2.0f, 3.0f);
+		emplace_tags(registry, e, i % archetypes, std::make_index_sequence<6>());
+	}
+	auto& group = registry.group<transform>();
+	for (auto _ : state)
+	{
+		apollo::job dependency;
+		apollo::job query = registry.for_each(group, [](apollo::entity& e, transform& t) {
+			t.m_x += 1.0f;
+		}, dependency);
+		query.schedule().complete();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+	state.counters["archetypes"] = static_cast<double>(archetypes);
+}
+BENCHMARK(BM_fragmentation_group)->ArgsProduct({ { 1 << 14 }, { 1, 4, 16, 64 } })->UseRealTime();
+
+// every shard creates count entities, moves one in eight to its neighbour and destroys its share again
+static void BM_sharded_structural(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	const std::size_t shards = state.range(1);
+	apollo::sharded_registry world(shards);
+	std::vector<std::vector<apollo::entity>> entities(shards, std::vector<apollo::entity>(count));
+	for (auto _ : state)
+	{
+		world.parallel([&](apollo::registry& registry, const std::size_t shard) {
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				apollo::entity e = world.create(shard);
+				apollo::entity local = world.locate(e).m_entity;
+				registry.emplace<transform>(local, 1.0f, 2.0f, 3.0f);
+				registry.emplace<velocity>(local, 1.0f);
+				if (i % 8 == 0)
+					world.migrate(e, (shard + 1) % shards);
+				entities[shard][i] = e;
+			}
+		});
+		world.sync();
+		world.parallel([&](apollo::registry&, const std::size_t shard) {
+			const std::size_t previous = (shard + shards - 1) % shards;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (i % 8 || shards == 1)
+					world.destroy(entities[shard][i]);
+				else
+					world.destroy(entities[previous][i]);
+			}
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * count * shards);
+}
+BENCHMARK(BM_sharded_structural)->ArgsProduct({ { 1 << 12 }, { 1, 2, 4, 8 } })->UseRealTime();
+
+class integrate_system : public apollo::system
+{
+public:
+	integrate_system(apollo::registry& registry)
+		: apollo::system(registry) {}
+
+	void update() override
+	{
+		for_each([](apollo::entity& e, transform& t, const velocity& v) {
+			t.m_x += v.m_velocity;
+		}).schedule();
+	}
+};
+
+class export_system : public apollo::extract_system
+{
+public:
+	void update(const apollo::world_view& view) override
+	{
+		float sum = 0.0f;
+		view.for_each([&sum](const apollo::entity& e, const transform& t, const mass& m) {
+			sum += t.m_x * m.m_mass;
+		});
+		benchmark::DoNotOptimize(sum);
+	}
+};
+
+static void BM_pipelined_update(benchmark::State& state)
+{
+	apollo::registry registry(state.range(2));
+	populate(registry, state.range(0));
+	registry.create_system<integrate_system>();
+	registry.create_extract_system<export_system>();
+	registry.set_pipeline_depth(state.range(1));
+	for (auto _ : state)
+		registry.update();
+	registry.flush_pipeline();
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_pipelined_update)->ArgsProduct({ { 1 << 14 }, { 1, 2, 4 }, { 1, 4 } })->UseRealTime();
+
+static void BM_thread_pool_jobs(benchmark::State& state)
+{
+	const std::size_t count = state.range(0);
+	apollo::thread_pool pool(state.range(1));
+	std::vector<apollo::job> jobs;
+	std::vector<apollo::job_handle> handles(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		jobs.emplace_back(&pool, []() {
+			benchmark::ClobberMemory();
+		});
+	}
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			handles[i] = jobs[i].schedule();
+		for (auto& handle : handles)
+			handle.complete();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_thread_pool_jobs)->ArgsProduct({ { 1 << 8, 1 << 12 }, { 1, 2, 4, 8 } })->UseRealTime();
+
+// Latency of a short frame job submitted while every worker is busy with chunked
+// background work. With range(1) set the background work goes into its own lane and
+// the frame job into the critical one; otherwise both queue FIFO in the normal lane.
+static void BM_critical_latency(benchmark::State& state)
+{
+	const std::size_t threads = state.range(0);
+	const bool lanes = state.range(1);
+	apollo::thread_pool pool(threads);
+	const apollo::job_priority background = lanes ? apollo::job_priority::background : apollo::job_priority::normal;
+	const apollo::job_priority critical = lanes ? apollo::job_priority::critical : apollo::job_priority::normal;
+	auto chunked = [&pool]() {
+		for (int chunk = 0; chunk < 16; ++chunk)
+		{
+			pool.preempt();
+			const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(10);
+			while (std::chrono::steady_clock::now() < end)
+				benchmark::ClobberMemory();
+		}
+	};
+	std::vector<std::future<void>> work;
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < threads * 4; ++i)
+			work.push_back(pool.enqueue(background, chunked));
+		const auto start = std::chrono::steady_clock::now();
+		pool.enqueue(critical, []() {
+			benchmark::ClobberMemory();
+		}).wait();
+		state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		for (auto& w : work)
+			w.wait();
+		work.clear();
+	}
+}
+BENCHMARK(BM_critical_latency)->ArgsProduct({ { 1, 4 }, { 0, 1 } })->UseManualTime();
+
+BENCHMARK_MAIN();
@@ -1 +1,4 @@
-#include "registry.h"
\ No newline at end of file
+#include "registry.h"
+#include "sharded_registry.h"
+#include "async_system.h"
+#include "reactive_system.h"
@@ -2,30 +2,48 @@
 #define APOLLO_ARCHETYPE_H
 
 #include <vector>
+#include <cstdint>
 #include <optional>
+#include <utility>
 #include <algorithm>
+#include <functional>
+#include <numeric>
+#include <memory_resource>
+#include "core/type_id.h"
 #include "component_storage.h"
 
 namespace apollo
 {
 	using storage_vec = std::vector<std::unique_ptr<component_storage>>;
 
+	class group_base;
+
 	class archetype
 	{
 	private:
 		id_type m_id;
+		std::pmr::memory_resource* m_resource;
 		std::size_t m_num_components = 0;
 		std::vector<id_type> m_signature;
+		std::uint64_t m_mask = 0;
 		storage_vec m_storages;
-		std::vector<entity> m_entities;
-		std::vector<archetype*> m_edges;
+		std::pmr::vector<entity> m_entities;
+		std::pmr::vector<std::uint64_t> m_versions;
+		std::pmr::vector<std::pair<id_type, archetype*>> m_edges;
+		bool m_sorted = false;
+		std::size_t m_sorted_size = 0;
+		std::function<bool(archetype&, std::size_t, std::size_t)> m_less;
+		group_base* m_group = nullptr;
+		// offset of the paged out columns in the registry's cold store
+		std::size_t m_page = invalid_index;
 	private:
-		explicit archetype(const id_type id, storage_vec& storages)
-			: m_id(id), m_storages(std::move(storages))
+		explicit archetype(const id_type id, storage_vec& storages, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_id(id), m_resource(resource), m_storages(std::move(storages)), m_entities(resource), m_versions(resource), m_edges(resource)
 		{
 			for (std::size_t i = 0; i < m_storages.size(); ++i)
 			{
 				add_to_signature(i, m_storages[i]->get_id());
+				m_mask |= type_mask_bit(m_storages[i]->get_hash());
 			}
 		}
 
@@ -59,8 +77,98 @@ namespace apollo
 			return static_cast<component_storage_impl<Component>*>(s.get());
 		}
 
+		void permute(const std::vector<std::size_t>& order)
+		{
+			std::for_each(m_storages.begin(), m_storages.end(), [&order](auto&& s) {
+				s->permute(order);
+			});
+			std::pmr::vector<entity> entities(m_resource);
+			std::pmr::vector<std::uint64_t> versions(m_resource);
+			entities.reserve(order.size());
+			versions.reserve(order.size());
+			for (std::size_t index : order)
+			{
+				entities.push_back(m_entities[index]);
+				versions.push_back(m_versions[index]);
+			}
+			m_entities.swap(entities);
+			m_versions.swap(versions);
+		}
+
+		void erase_row(const std::size_t index)
+		{
+			if (index < m_sorted_size)
+			{
+				std::for_each(m_storages.begin(), m_storages.end(), [&index](auto&& s) {
+					s->erase(index);
+				});
+				m_entities.erase(m_entities.begin() + index);
+				m_versions.erase(m_versions.begin() + index);
+				--m_sorted_size;
+				return;
+			}
+			std::for_each(m_storages.begin(), m_storages.end(), [&index](auto&& s) {
+				s->remove(index);
+			});
+			m_entities[index] = m_entities.back();
+			m_entities.resize(m_entities.size() - 1);
+			m_versions[index] = m_versions.back();
+			m_versions.pop_back();
+		}
+
+		// Keeps only the given ascending rows, compacting every column in place.
+		void retain(const std::vector<std::size_t>& rows)
+		{
+			const std::size_t sorted = std::distance(rows.begin(), std::lower_bound(rows.begin(), rows.end(), m_sorted_size));
+			std::for_each(m_storages.begin(), m_storages.end(), [&rows](auto&& s) {
+				s->retain(rows);
+			});
+			for (std::size_t i = 0; i < rows.size(); ++i)
+			{
+				m_entities[i] = m_entities[rows[i]];
+				m_versions[i] = m_versions[rows[i]];
+			}
+			m_entities.resize(rows.size());
+			m_versions.resize(rows.size());
+			m_sorted_size = sorted;
+		}
+
+		void reserve(const std::size_t capacity)
+		{
+			std::for_each(m_storages.begin(), m_storages.end(), [capacity](auto&& s) {
+				s->reserve(capacity);
+			});
+			m_entities.reserve(capacity);
+			m_versions.reserve(capacity);
+		}
+
+		void clear()
+		{
+			std::for_each(m_storages.begin(), m_storages.end(), [](auto&& s) {
+				s->clear();
+			});
+			m_entities.clear();
+			m_versions.clear();
+			m_sorted_size = 0;
+		}
+
+		// Moves the given ascending rows of source to the end of this archetype, dropping
+		// the components it does not hold. Source keeps the rows until it is retained or cleared.
+		void append(archetype& source, const std::vector<std::size_t>& rows, const std::uint64_t tick)
+		{
+			std::for_each(m_storages.begin(), m_storages.end(), [&source, &rows](auto&& s) {
+				s->append(*source.get_storage(s->get_id()), rows);
+			});
+			m_entities.reserve(m_entities.size() + rows.size());
+			for (std::size_t row : rows)
+				m_entities.push_back(source.m_entities[row]);
+			m_versions.resize(m_entities.size(), tick);
+		}
+
 		component_storage* get_storage(const id_type component_id)
 		{
+			if (component_id >= m_signature.size())
+				return nullptr;
 			size_t index = m_signature[component_id];
 			if (index == invalid_index)
 			{
@@ -70,16 +178,26 @@ namespace apollo
 			return s.get();
 		}
 	public:
-		archetype(const id_type id)
-			: m_id(id)
+		archetype(const id_type id, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_id(id), m_resource(resource), m_entities(resource), m_versions(resource), m_edges(resource)
 		{
 		}
 
-		archetype(const id_type id, std::unique_ptr<component_storage>&& storage)
-			: m_id(id)
+		archetype(const id_type id, std::unique_ptr<component_storage>&& storage, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_id(id), m_resource(resource), m_entities(resource), m_versions(resource), m_edges(resource)
 		{
 			m_storages.push_back(std::move(storage));
 			add_to_signature(0, m_storages[0]->get_id());
+			m_mask = type_mask_bit(m_storages[0]->get_hash());
+		}
+
+		template <typename... Args>
+		static archetype* make(std::pmr::memory_resource* resource, Args&&... args)
+		{
+			std::pmr::polymorphic_allocator<archetype> allocator(resource);
+			archetype* a = allocator.allocate(1);
+			new (a) archetype(std::forward<Args>(args)..., resource);
+			return a;
 		}
 
 		inline const id_type get_id() const
@@ -87,31 +205,201 @@ namespace apollo
 			return m_id;
 		}
 
-		inline std::vector<entity>& get_entities()
+		inline std::pmr::memory_resource* get_resource() const
+		{
+			return m_resource;
+		}
+
+		inline std::pmr::vector<entity>& get_entities()
 		{
 			return m_entities;
 		}
 
-		inline const std::vector<entity>& get_entities() const
+		inline const std::pmr::vector<entity>& get_entities() const
 		{
 			return m_entities;
 		}
 
 		inline archetype* get_edge(const std::size_t component_id)
 		{
-			if (component_id < m_edges.size())
-				return m_edges[component_id];
+			auto it = std::lower_bound(m_edges.begin(), m_edges.end(), component_id, [](const auto& edge, const std::size_t id) {
+				return edge.first < id;
+			});
+			if (it != m_edges.end() && it->first == component_id)
+				return it->second;
 			return nullptr;
 		}
 
+		inline void set_edge(const std::size_t component_id, archetype* edge)
+		{
+			auto it = std::lower_bound(m_edges.begin(), m_edges.end(), component_id, [](const auto& edge, const std::size_t id) {
+				return edge.first < id;
+			});
+			if (it != m_edges.end() && it->first == component_id)
+				it->second = edge;
+			else
+				m_edges.emplace(it, component_id, edge);
+		}
+
+		void shrink_to_fit()
+		{
+			std::for_each(m_storages.begin(), m_storages.end(), [](auto&& s) {
+				s->shrink_to_fit();
+			});
+			m_entities.shrink_to_fit();
+			m_versions.shrink_to_fit();
+			m_edges.shrink_to_fit();
+		}
+
+		// Sorted archetypes keep rows ordered by entity id, or by less when it is given. Rows are
+		// appended to an unsorted tail that is merged in once it outgrows sqrt(size), which keeps
+		// both the merges and the linear scan of the tail in lookups amortized.
+		void set_order(std::function<bool(archetype&, std::size_t, std::size_t)> less)
+		{
+			m_sorted = true;
+			m_less = std::move(less);
+			sort();
+		}
+
+		void set_unordered()
+		{
+			m_sorted = false;
+			m_sorted_size = 0;
+			m_less = nullptr;
+		}
+
+		inline bool is_sorted() const
+		{
+			return m_sorted;
+		}
+
+		void sort()
+		{
+			m_sorted_size = 0;
+			merge_sorted_tail();
+		}
+
+		void merge_sorted_tail()
+		{
+			if (!m_sorted || m_sorted_size == m_entities.size())
+				return;
+			std::vector<std::size_t> order(m_entities.size());
+			std::iota(order.begin(), order.end(), 0);
+			auto less = [this](const std::size_t lhs, const std::size_t rhs) {
+				return m_less ? m_less(*this, lhs, rhs) : m_entities[lhs] < m_entities[rhs];
+			};
+			auto middle = order.begin() + m_sorted_size;
+			std::sort(middle, order.end(), less);
+			std::inplace_merge(order.begin(), middle, order.end(), less);
+			permute(order);
+			m_sorted_size = m_entities.size();
+		}
+
+		bool maintain_order()
+		{
+			const std::size_t tail = m_entities.size() - m_sorted_size;
+			if (!m_sorted || tail <= 16 || tail * tail <= m_entities.size())
+				return false;
+			merge_sorted_tail();
+			return true;
+		}
+
+		inline group_base* get_group() const
+		{
+			return m_group;
+		}
+
+		inline void set_group(group_base* group)
+		{
+			m_group = group;
+		}
+
+		// Cold archetypes keep their entities and versions resident while their
+		// columns live in the cold store, one after the other, at get_page().
+		inline bool is_cold() const
+		{
+			return m_page != invalid_index;
+		}
+
+		inline std::size_t get_page() const
+		{
+			return m_page;
+		}
+
+		inline void set_page(const std::size_t page)
+		{
+			m_page = page;
+		}
+
+		bool pageable() const
+		{
+			return std::all_of(m_storages.begin(), m_storages.end(), [](auto&& s) {
+				return s->pageable();
+			});
+		}
+
+		std::size_t page_bytes() const
+		{
+			std::size_t bytes = 0;
+			for (const auto& s : m_storages)
+				bytes += s->page_bytes(m_entities.size());
+			return bytes;
+		}
+
+		// Offset of the column of storage index within the page.
+		std::size_t page_offset(const std::size_t index) const
+		{
+			std::size_t offset = 0;
+			for (std::size_t i = 0; i < index; ++i)
+				offset += m_storages[i]->page_bytes(m_entities.size());
+			return offset;
+		}
+
+		void page_out(std::byte* destination)
+		{
+			for (auto& s : m_storages)
+			{
+				const std::size_t bytes = s->page_bytes(m_entities.size());
+				s->page_out(destination);
+				destination += bytes;
+			}
+		}
+
+		void page_in(const std::byte* source)
+		{
+			for (auto& s : m_storages)
+			{
+				s->page_in(source, m_entities.size());
+				source += s->page_bytes(m_entities.size());
+			}
+			m_page = invalid_index;
+		}
+
+		void relocate_storage(const id_type component_id, std::pmr::memory_resource* resource, const std::size_t capacity)
+		{
+			auto& s = m_storages[m_signature[component_id]];
+			s = s->relocate(resource, capacity);
+		}
+
+		inline void set_version_at(const std::size_t index, const std::uint64_t tick)
+		{
+			m_versions[index] = tick;
+		}
+
+		inline void set_versions(const std::size_t begin, const std::size_t count, const std::uint64_t tick)
+		{
+			std::fill(m_versions.begin() + begin, m_versions.begin() + begin + count, tick);
+		}
+
 		inline const std::size_t get_num_components() const
 		{
 			return m_num_components;
 		}
 
 		template<typename Component>
-		std::vector<Component>* get_components()
+		std::pmr::vector<Component>* get_components()
 		{
+			static_assert(!is_soa<Component>::value, "SoA components have no contiguous vector, use get_column or get_field");
 			auto storage = get_storage<Component>();
 			if (storage)
 			{
@@ -121,11 +409,49 @@ namespace apollo
 		}
 
 		template<typename Component>
-		Component& get_component(const entity& entity)
+		auto get_column()
+		{
+			if constexpr (is_soa<Component>::value)
+				return get_storage<Component>();
+			else
+				return get_components<Component>();
+		}
+
+		template<typename Component>
+		static Component& column_at(std::pmr::vector<Component>* column, const std::size_t index)
+		{
+			return column->operator[](index);
+		}
+
+		template<typename Component>
+		static soa_ref<Component> column_at(component_storage_impl<Component>* column, const std::size_t index)
+		{
+			return soa_ref<Component>(column, index);
+		}
+
+		template<typename Span>
+		Span get_column_span(const std::size_t begin, const std::size_t count)
+		{
+			using component = component_type_t<Span>;
+			if constexpr (is_soa<component>::value)
+				return Span(get_storage<component>(), begin, count);
+			else
+				return Span(get_components<component>()->data() + begin, count);
+		}
+
+		template<auto Field>
+		auto* get_field()
+		{
+			using component = typename member_pointer_traits<decltype(Field)>::class_type;
+			auto storage = get_storage<component>();
+			return storage ? &storage->template field<Field>() : nullptr;
+		}
+
+		template<typename Component>
+		component_reference_t<Component> get_component(const entity& entity)
 		{
 			std::size_t index = search(entity);
-			auto components = get_components<Component>();
-			return components->operator[](index);
+			return get_component_at<Component>(index);
 		}
 
 		template<typename Component>
@@ -141,30 +467,29 @@ namespace apollo
 		}
 
 		template<typename Component>
-		Component& get_component_at(const std::size_t& index)
+		component_reference_t<Component> get_component_at(const std::size_t& index)
 		{
-			auto components = get_components<Component>();
-			return components->operator[](index);
+			return column_at(get_column<Component>(), index);
 		}
 
 		template<typename... TComponents>
-		std::tuple<TComponents&...> get_components(const entity& entity)
+		std::tuple<component_reference_t<TComponents>...> get_components(const entity& entity)
 		{
 			std::size_t index = search(entity);
-			std::tuple<TComponents&...> components{ get_components<TComponents>()->operator[](index)... };
+			std::tuple<component_reference_t<TComponents>...> components{ get_component_at<TComponents>(index)... };
 			return components;
 		}
 
 		template<typename... TComponents>
-		std::optional<std::tuple<TComponents&...>> try_get_components(const entity& entity)
+		std::optional<std::tuple<component_reference_t<TComponents>...>> try_get_components(const entity& entity)
 		{
 			std::size_t index = search(entity);
 			if (index >= m_entities.size())
 				return {};
 			if (!has_all<TComponents...>())
 				return {};
-			std::tuple<TComponents&...> components{ get_components<TComponents>()->operator[](index)... };
-			return std::optional<std::tuple<TComponents&...>>{components};
+			std::tuple<component_reference_t<TComponents>...> components{ get_component_at<TComponents>(index)... };
+			return std::optional<std::tuple<component_reference_t<TComponents>...>>{components};
 		}
 
 		void add(const entity& entity)
@@ -173,24 +498,26 @@ namespace apollo
 				s->add();
 			});
 			m_entities.resize(m_entities.size() + 1, entity);
+			m_versions.push_back(0);
 		}
 
 		inline std::size_t search(entity entity)
 		{
+			if (m_sorted && !m_less)
+			{
+				auto sorted_end = m_entities.begin() + m_sorted_size;
+				auto it = std::lower_bound(m_entities.begin(), sorted_end, entity);
+				if (it != sorted_end && *it == entity)
+					return std::distance(m_entities.begin(), it);
+				return std::distance(m_entities.begin(), std::find(sorted_end, m_entities.end(), entity));
+			}
 			return std::distance(m_entities.begin(), std::find(m_entities.begin(), m_entities.end(), entity));
 		}
 
 		template<typename Component, typename... Args>
 		void set(const entity& entity, Args&&... args)
 		{
-			auto storage = get_storage<Component>();
-			if (storage)
-			{
-				std::size_t index = search(entity);
-				if (index >= m_entities.size())
-					return;
-				storage->m_components[index] = Component(std::forward<Args>(args)...);
-			}
+			set_at<Component>(search(entity), std::forward<Args>(args)...);
 		}
 
 		template<typename Component, typename... Args>
@@ -201,23 +528,19 @@ namespace apollo
 			{
 				if (index >= m_entities.size())
 					return;
-				storage->m_components[index] = Component(std::forward<Args>(args)...);
+				if constexpr (is_soa<Component>::value)
+					storage->scatter(index, Component(std::forward<Args>(args)...));
+				else
+					storage->m_components[index] = Component(std::forward<Args>(args)...);
 			}
 		}
 
 		void remove(const entity& entity)
 		{
-			// TODO: doing sparse like set removal which is fast for adding/removing entities from Archetype
-			// Should implement a config variable to decide between fast addition/removal of entities or fast entities lookup
-			// by sorting the entities vector
 			std::size_t index = search(entity);
 			if (index >= m_entities.size())
 				return;
-			std::for_each(m_storages.begin(), m_storages.end(), [&index](auto&& s) {
-				s->remove(index);
-			});
-			m_entities[index] = m_entities.back();
-			m_entities.resize(m_entities.size() - 1);
+			erase_row(index);
 		}
 
 		template <typename... TComponent>
@@ -248,16 +571,18 @@ namespace apollo
 				{
 					s->move(*destination.get_storage(s->get_id()), index);
 				}
-				s->remove(index);
 				++i;
 			});
-			m_entities[index] = m_entities.back();
-			m_entities.resize(m_entities.size() - 1);
+			erase_row(index);
 		}
 
 		template<typename... Component>
 		bool has_all()
 		{
+			using signature = type_list_signature<Component...>;
+			static_assert(signature::collision_free, "two component types hash to the same type id, rename one of them");
+			if ((m_mask & signature::mask) != signature::mask)
+				return false;
 			return ((Component::id < m_signature.size() && m_signature[Component::id] != invalid_index) && ...);
 		}
 
@@ -269,44 +594,45 @@ namespace apollo
 				storage_vec storage;
 				storage.reserve(m_storages.size() + 1);
 
-				std::transform(m_storages.begin(), m_storages.end(), back_inserter(storage), [](auto&& s) {
-					return s->create();
+				std::transform(m_storages.begin(), m_storages.end(), back_inserter(storage), [this](auto&& s) {
+					return s->create(m_resource);
 				});
 
-				storage.push_back(std::make_unique<component_storage_impl<Component>>());
+				storage.push_back(std::make_unique<component_storage_impl<Component>>(m_resource));
 
-				if (m_edges.capacity() < Component::id + 1)
-					m_edges.resize(Component::id + 1, nullptr);
-				m_edges[Component::id] = new archetype(id, storage);
-				m_edges[Component::id]->m_edges.resize(Component::id + 1, nullptr);
-				m_edges[Component::id]->m_edges[Component::id] = this;
+				archetype* edge = make(m_resource, id, storage);
+				set_edge(Component::id, edge);
+				edge->set_edge(Component::id, this);
 			}
-			return m_edges[Component::id];
+			return get_edge(Component::id);
 		}
 
 		template<typename Component>
 		archetype* with_removed_component(id_type id)
 		{
-			if (!get_edge(Component::id))
+			return with_removed_component(Component::id, id);
+		}
+
+		archetype* with_removed_component(const id_type component_id, const id_type id)
+		{
+			if (!get_edge(component_id))
 			{
 				storage_vec storage;
 				storage.reserve(m_storages.size() - 1);
 
-				std::for_each(m_storages.begin(), m_storages.end(), [&storage](auto&& s)
+				std::for_each(m_storages.begin(), m_storages.end(), [this, &storage, component_id](auto&& s)
 				{
-					if (s->get_id() != Component::id)
+					if (s->get_id() != component_id)
 					{
-						storage.push_back(s->create());
+						storage.push_back(s->create(m_resource));
 					}
 				});
 
-				if (m_edges.capacity() < Component::id + 1)
-					m_edges.resize(Component::id + 1, nullptr);
-				m_edges[Component::id] = new archetype(id, storage);
-				m_edges[Component::id]->m_edges.resize(Component::id + 1, nullptr);
-				m_edges[Component::id]->m_edges[Component::id] = this;
+				archetype* edge = make(m_resource, id, storage);
+				set_edge(component_id, edge);
+				edge->set_edge(component_id, this);
 			}
-			return m_edges[Component::id];
+			return get_edge(component_id);
 		}
 
 		friend class registry;
@@ -314,20 +640,34 @@ namespace apollo
 		friend bool operator!=(const archetype& lhs, const archetype& rhs);
 	};
 
-	bool operator==(const archetype& lhs, const archetype& rhs)
+	struct archetype_deleter
+	{
+		void operator()(archetype* a) const
+		{
+			std::pmr::polymorphic_allocator<archetype> allocator(a->get_resource());
+			a->~archetype();
+			allocator.deallocate(a, 1);
+		}
+	};
+
+	using archetype_ptr = std::unique_ptr<archetype, archetype_deleter>;
+
+	inline bool operator==(const archetype& lhs, const archetype& rhs)
 	{
-		if (lhs.m_signature.size() != rhs.m_signature.size())
+		if (lhs.m_num_components != rhs.m_num_components)
 			return false;
-		for (std::size_t i = 0; i < lhs.m_signature.size(); ++i)
+		const std::size_t size = std::max(lhs.m_signature.size(), rhs.m_signature.size());
+		for (std::size_t i = 0; i < size; ++i)
 		{
-			if ((lhs.m_signature[i] == invalid_index && rhs.m_signature[i] != invalid_index) ||
-				(lhs.m_signature[i] != invalid_index && rhs.m_signature[i] == invalid_index))
+			const bool in_lhs = i < lhs.m_signature.size() && lhs.m_signature[i] != invalid_index;
+			const bool in_rhs = i < rhs.m_signature.size() && rhs.m_signature[i] != invalid_index;
+			if (in_lhs != in_rhs)
 				return false;
 		}
 		return true;
 	}
 
-	bool operator!=(const archetype& lhs, const archetype& rhs)
+	inline bool operator!=(const archetype& lhs, const archetype& rhs)
 	{
 		return !(lhs == rhs);
 	}
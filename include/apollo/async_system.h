@@ -0,0 +1,88 @@
+#ifndef APOLLO_ASYNC_SYSTEM_H
+#define APOLLO_ASYNC_SYSTEM_H
+
+#ifdef APOLLO_ENABLE_COROUTINES
+
+#include "registry.h"
+#include "system.h"
+#include "job/task.h"
+#include <coroutine>
+#include <thread>
+
+namespace apollo
+{
+	class sync_point_awaiter
+	{
+	private:
+		registry& m_registry;
+	public:
+		explicit sync_point_awaiter(registry& registry)
+			: m_registry(registry)
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			m_registry.at_sync_point([handle]() {
+				handle.resume();
+			});
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	// System whose update is a coroutine: update() starts run() once the
+	// previous run has finished and returns at its first suspension. After
+	// awaiting a job the coroutine continues on a pool worker and may only touch
+	// components; structural changes go after co_await next_sync_point(), which
+	// resumes it on the thread calling registry::update.
+	class async_system : public system
+	{
+	private:
+		task m_task;
+	protected:
+		async_system(registry& registry)
+			: system(registry) {}
+
+		virtual task run() = 0;
+
+		inline sync_point_awaiter next_sync_point()
+		{
+			return sync_point_awaiter(m_registry);
+		}
+	public:
+		// A run suspended on a job resumes on a worker, and one waiting for a sync
+		// point only through the registry, so it is driven to its end here.
+		void finish() override
+		{
+			while (!m_task.done())
+			{
+				if (!m_registry.run_sync_point())
+					std::this_thread::yield();
+			}
+			complete();
+		}
+
+		void update() final
+		{
+			if (m_task.done())
+				m_task = run();
+		}
+
+		inline bool running() const
+		{
+			return !m_task.done();
+		}
+	};
+}
+
+#endif // APOLLO_ENABLE_COROUTINES
+
+#endif // !APOLLO_ASYNC_SYSTEM_H
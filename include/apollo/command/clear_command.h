@@ -1,5 +1,5 @@
-#ifndef APOLLO_COMMAND_DESTROY_COMMAND
-#define APOLLO_COMMAND_DESTROY_COMMAND
+#ifndef APOLLO_COMMAND_CLEAR_COMMAND
+#define APOLLO_COMMAND_CLEAR_COMMAND
 
 #include "command.h"
 #include "../core/common.h"
@@ -10,16 +10,16 @@ namespace apollo
 	class clear_command : public command
 	{
 	public:
-		remove_command(registry* registry)
+		clear_command(registry* registry)
 			: command(registry)
 		{
 		}
 
 		void execute() override
 		{
-			m_registry->clear<Components...>(m_entity);
+			m_registry->template clear<Components...>();
 		}
 	};
 }
 
-#endif // !APOLLO_COMMAND_DESTROY_COMMAND
+#endif // !APOLLO_COMMAND_CLEAR_COMMAND
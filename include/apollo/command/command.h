@@ -1,6 +1,8 @@
 #ifndef APOLLO_COMMAND_COMMAND_H
 #define APOLLO_COMMAND_COMMAND_H
 
+#include "../core/common.h"
+
 namespace apollo
 {
 	class registry;
@@ -20,6 +22,13 @@ namespace apollo
 		}
 
 		virtual void execute() = 0;
+
+		// Structural commands report the entity they change and the component they
+		// remove (invalid_index to destroy it), so playback can batch them.
+		virtual bool describe(entity&, id_type&) const
+		{
+			return false;
+		}
 	};
 }
 
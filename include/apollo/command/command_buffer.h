@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include "command.h"
+#include "../core/trace.h"
 
 namespace apollo
 {
@@ -25,8 +26,14 @@ namespace apollo
 			m_commands.push_back(std::make_unique<TCommand>(m_registry, std::forward<Args>(args)...));
 		}
 
+		inline const std::vector<std::unique_ptr<command>>& get_commands() const
+		{
+			return m_commands;
+		}
+
 		void execute()
 		{
+			APOLLO_TRACE_SCOPE("command_buffer::execute", "command");
 			for (auto& command : m_commands)
 				command->execute();
 		}
@@ -21,6 +21,13 @@ namespace apollo
 		{
 			m_registry->destroy(m_entity);
 		}
+
+		bool describe(entity& entity, id_type& component) const override
+		{
+			entity = m_entity;
+			component = invalid_index;
+			return true;
+		}
 	};
 }
 
@@ -1,5 +1,5 @@
-#ifndef APOLLO_COMMAND_DESTROY_COMMAND
-#define APOLLO_COMMAND_DESTROY_COMMAND
+#ifndef APOLLO_COMMAND_REMOVE_COMMAND
+#define APOLLO_COMMAND_REMOVE_COMMAND
 
 #include "command.h"
 #include "../core/common.h"
@@ -20,9 +20,16 @@ namespace apollo
 
 		void execute() override
 		{
-			m_registry->remove<Component>(m_entity);
+			m_registry->template remove<Component>(m_entity);
+		}
+
+		bool describe(entity& entity, id_type& component) const override
+		{
+			entity = m_entity;
+			component = Component::id;
+			return true;
 		}
 	};
 }
 
-#endif // !APOLLO_COMMAND_DESTROY_COMMAND
+#endif // !APOLLO_COMMAND_REMOVE_COMMAND
@@ -2,17 +2,22 @@
 #define APOLLO_COMPONENT_H
 
 #include "core/common.h"
+#include "core/type_id.h"
 #include <atomic>
+#include <cstdint>
 
 namespace apollo
 {
-	static std::atomic<id_type> current_id = 0;
+	inline std::atomic<id_type> current_id = 0;
 
 	template <typename T>
 	class component
 	{
 	public:
+		// dense per-process slot used to index archetype signatures
 		inline static const id_type id = current_id++;
+		// stable across builds, used by snapshots and query masks
+		static constexpr std::uint64_t hash = type_hash<T>();
 	};
 };
 
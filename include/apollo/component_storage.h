@@ -2,7 +2,14 @@
 #define APOLLO_COMPONENT_STORAGE_H
 
 #include "core/common.h"
+#include "soa.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <vector>
 
 namespace apollo
@@ -12,29 +19,77 @@ namespace apollo
 	protected:
 		component_storage() = default;
 	public:
+		virtual ~component_storage() = default;
+
 		virtual id_type get_id() const = 0;
-		virtual std::unique_ptr<component_storage> create() const = 0;
+		virtual std::uint64_t get_hash() const = 0;
+		virtual std::unique_ptr<component_storage> create(std::pmr::memory_resource* resource) const = 0;
+		virtual std::unique_ptr<component_storage> relocate(std::pmr::memory_resource* resource, const std::size_t capacity) = 0;
 		virtual void add() = 0;
 		virtual void remove(const std::size_t index) = 0;
+		virtual void erase(const std::size_t index) = 0;
+		virtual void permute(const std::vector<std::size_t>& order) = 0;
+		// moves the given ascending rows of source to the end of this column, source keeps them moved-from
+		virtual void append(component_storage& source, const std::vector<std::size_t>& rows) = 0;
+		// keeps only the given ascending rows, in place
+		virtual void retain(const std::vector<std::size_t>& rows) = 0;
+		virtual void reserve(const std::size_t capacity) = 0;
+		virtual void clear() = 0;
+		// appends count copies of the component at index
+		virtual void fill(const std::size_t index, const std::size_t count) = 0;
 		virtual void copy(component_storage& destination, const std::size_t index) = 0;
 		virtual void move(component_storage& destination, const std::size_t index) = 0;
+		virtual std::size_t size() const = 0;
+		virtual std::size_t capacity() const = 0;
+		virtual void shrink_to_fit() = 0;
+		virtual std::size_t element_size() const = 0;
+		// false when the column is not one contiguous array of components (SoA)
+		virtual bool trivially_copyable() const = 0;
+		virtual const void* data() const = 0;
+		virtual void assign(const void* data, const std::size_t count) = 0;
+		virtual void assign_at(const std::size_t index, const void* data) = 0;
+		virtual std::shared_ptr<const void> clone_range(const std::size_t begin, const std::size_t count) const = 0;
+		// paging of cold archetypes, only for trivially copyable components
+		virtual bool pageable() const = 0;
+		virtual std::size_t page_bytes(const std::size_t count) const = 0;
+		// copies the column to destination and frees its memory
+		virtual void page_out(std::byte* destination) = 0;
+		virtual void page_in(const std::byte* source, const std::size_t count) = 0;
 	};
 
-	template <typename Component>
+	template <typename Component, typename = void>
 	class component_storage_impl : public component_storage
 	{
 	public:
 		using value_type = Component;
-		std::vector<Component> m_components;
+		std::pmr::vector<Component> m_components;
 	public:
+		explicit component_storage_impl(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_components(resource)
+		{
+		}
+
 		inline id_type get_id() const override
 		{
 			return Component::id;
 		}
 
-		std::unique_ptr<component_storage> create() const override
+		inline std::uint64_t get_hash() const override
+		{
+			return Component::hash;
+		}
+
+		std::unique_ptr<component_storage> create(std::pmr::memory_resource* resource) const override
+		{
+			return std::make_unique<component_storage_impl>(resource);
+		}
+
+		std::unique_ptr<component_storage> relocate(std::pmr::memory_resource* resource, const std::size_t capacity) override
 		{
-			return std::make_unique<component_storage_impl>();
+			auto storage = std::make_unique<component_storage_impl>(resource);
+			storage->m_components.reserve(std::max(capacity, m_components.size()));
+			std::move(m_components.begin(), m_components.end(), std::back_inserter(storage->m_components));
+			return storage;
 		}
 
 		void add() override
@@ -48,6 +103,64 @@ namespace apollo
 			m_components.resize(m_components.size() - 1);
 		}
 
+		void erase(const std::size_t index) override
+		{
+			m_components.erase(m_components.begin() + index);
+		}
+
+		void permute(const std::vector<std::size_t>& order) override
+		{
+			std::pmr::vector<Component> components(m_components.get_allocator());
+			components.reserve(m_components.size());
+			for (std::size_t index : order)
+				components.push_back(std::move(m_components[index]));
+			m_components.swap(components);
+		}
+
+		void append(component_storage& source, const std::vector<std::size_t>& rows) override
+		{
+			auto& components = static_cast<component_storage_impl&>(source).m_components;
+			if (rows.size() == components.size())
+			{
+				m_components.insert(m_components.end(), std::make_move_iterator(components.begin()), std::make_move_iterator(components.end()));
+				return;
+			}
+			m_components.reserve(m_components.size() + rows.size());
+			for (std::size_t row : rows)
+				m_components.push_back(std::move(components[row]));
+		}
+
+		void retain(const std::vector<std::size_t>& rows) override
+		{
+			for (std::size_t i = 0; i < rows.size(); ++i)
+			{
+				if (rows[i] != i)
+					m_components[i] = std::move(m_components[rows[i]]);
+			}
+			m_components.erase(m_components.begin() + rows.size(), m_components.end());
+		}
+
+		void reserve(const std::size_t capacity) override
+		{
+			m_components.reserve(capacity);
+		}
+
+		void clear() override
+		{
+			m_components.clear();
+		}
+
+		void fill(const std::size_t index, const std::size_t count) override
+		{
+			const Component component = m_components[index];
+			append_copies(component, count);
+		}
+
+		void append_copies(const Component& component, const std::size_t count)
+		{
+			m_components.insert(m_components.end(), count, component);
+		}
+
 		void copy(component_storage& destination, const std::size_t index) override
 		{
 			static_cast<component_storage_impl&>(destination).m_components.back() = m_components[index];
@@ -57,7 +170,442 @@ namespace apollo
 		{
 			static_cast<component_storage_impl&>(destination).m_components.back() = std::move(m_components[index]);
 		}
+
+		inline std::size_t size() const override
+		{
+			return m_components.size();
+		}
+
+		inline std::size_t capacity() const override
+		{
+			return m_components.capacity();
+		}
+
+		void shrink_to_fit() override
+		{
+			m_components.shrink_to_fit();
+		}
+
+		inline std::size_t element_size() const override
+		{
+			return sizeof(Component);
+		}
+
+		inline bool trivially_copyable() const override
+		{
+			return std::is_trivially_copyable<Component>::value;
+		}
+
+		const void* data() const override
+		{
+			return m_components.data();
+		}
+
+		void assign(const void* data, const std::size_t count) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				m_components.resize(count);
+				if (count)
+					std::memcpy(m_components.data(), data, count * sizeof(Component));
+			}
+		}
+
+		void assign_at(const std::size_t index, const void* data) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+				std::memcpy(&m_components[index], data, sizeof(Component));
+		}
+
+		std::shared_ptr<const void> clone_range(const std::size_t begin, const std::size_t count) const override
+		{
+			return std::make_shared<const std::vector<Component>>(m_components.begin() + begin, m_components.begin() + begin + count);
+		}
+
+		inline bool pageable() const override
+		{
+			return std::is_trivially_copyable<Component>::value;
+		}
+
+		inline std::size_t page_bytes(const std::size_t count) const override
+		{
+			return count * sizeof(Component);
+		}
+
+		void page_out(std::byte* destination) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				if (!m_components.empty())
+					std::memcpy(destination, m_components.data(), m_components.size() * sizeof(Component));
+				std::pmr::vector<Component>(m_components.get_allocator()).swap(m_components);
+			}
+		}
+
+		void page_in(const std::byte* source, const std::size_t count) override
+		{
+			assign(source, count);
+		}
+	};
+	template <typename Component>
+	class component_storage_impl<Component, std::enable_if_t<is_soa<Component>::value>> : public component_storage
+	{
+	public:
+		using value_type = Component;
+		using layout = soa_layout<Component>;
+		typename layout::columns m_fields;
+	private:
+		template <std::size_t... I>
+		static typename layout::columns make_columns(std::pmr::memory_resource* resource, std::index_sequence<I...>)
+		{
+			return typename layout::columns{ std::tuple_element_t<I, typename layout::columns>(resource)... };
+		}
+
+		template <typename Fn>
+		static void for_each_field(Fn&& fn)
+		{
+			for_each_field(fn, std::make_index_sequence<layout::size>());
+		}
+
+		template <typename Fn, std::size_t... I>
+		static void for_each_field(Fn& fn, std::index_sequence<I...>)
+		{
+			(fn(std::integral_constant<std::size_t, I>()), ...);
+		}
+	public:
+		explicit component_storage_impl(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_fields(make_columns(resource, std::make_index_sequence<layout::size>()))
+		{
+		}
+
+		template <auto Field>
+		auto& field()
+		{
+			return std::get<layout::template index<Field>>(m_fields);
+		}
+
+		Component gather(const std::size_t index) const
+		{
+			Component component{};
+			for_each_field([&](auto i) {
+				component.*std::get<decltype(i)::value>(layout::members) = std::get<decltype(i)::value>(m_fields)[index];
+			});
+			return component;
+		}
+
+		void scatter(const std::size_t index, const Component& component)
+		{
+			for_each_field([&](auto i) {
+				std::get<decltype(i)::value>(m_fields)[index] = component.*std::get<decltype(i)::value>(layout::members);
+			});
+		}
+
+		inline id_type get_id() const override
+		{
+			return Component::id;
+		}
+
+		inline std::uint64_t get_hash() const override
+		{
+			return Component::hash;
+		}
+
+		std::unique_ptr<component_storage> create(std::pmr::memory_resource* resource) const override
+		{
+			return std::make_unique<component_storage_impl>(resource);
+		}
+
+		std::unique_ptr<component_storage> relocate(std::pmr::memory_resource* resource, const std::size_t capacity) override
+		{
+			auto storage = std::make_unique<component_storage_impl>(resource);
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				auto& target = std::get<decltype(i)::value>(storage->m_fields);
+				target.reserve(std::max(capacity, column.size()));
+				std::move(column.begin(), column.end(), std::back_inserter(target));
+			});
+			return storage;
+		}
+
+		void add() override
+		{
+			for_each_field([this](auto i) {
+				std::get<decltype(i)::value>(m_fields).emplace_back();
+			});
+		}
+
+		void remove(const std::size_t index) override
+		{
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				std::swap(column[index], column.back());
+				column.pop_back();
+			});
+		}
+
+		void erase(const std::size_t index) override
+		{
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				column.erase(column.begin() + index);
+			});
+		}
+
+		void permute(const std::vector<std::size_t>& order) override
+		{
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				std::remove_reference_t<decltype(column)> permuted(column.get_allocator());
+				permuted.reserve(column.size());
+				for (std::size_t index : order)
+					permuted.push_back(std::move(column[index]));
+				column.swap(permuted);
+			});
+		}
+
+		void append(component_storage& source, const std::vector<std::size_t>& rows) override
+		{
+			auto& other = static_cast<component_storage_impl&>(source);
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				auto& from = std::get<decltype(i)::value>(other.m_fields);
+				if (rows.size() == from.size())
+				{
+					column.insert(column.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+					return;
+				}
+				column.reserve(column.size() + rows.size());
+				for (std::size_t row : rows)
+					column.push_back(std::move(from[row]));
+			});
+		}
+
+		void retain(const std::vector<std::size_t>& rows) override
+		{
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				for (std::size_t j = 0; j < rows.size(); ++j)
+				{
+					if (rows[j] != j)
+						column[j] = std::move(column[rows[j]]);
+				}
+				column.erase(column.begin() + rows.size(), column.end());
+			});
+		}
+
+		void reserve(const std::size_t capacity) override
+		{
+			for_each_field([&](auto i) {
+				std::get<decltype(i)::value>(m_fields).reserve(capacity);
+			});
+		}
+
+		void clear() override
+		{
+			for_each_field([this](auto i) {
+				std::get<decltype(i)::value>(m_fields).clear();
+			});
+		}
+
+		void fill(const std::size_t index, const std::size_t count) override
+		{
+			append_copies(gather(index), count);
+		}
+
+		void append_copies(const Component& component, const std::size_t count)
+		{
+			for_each_field([&](auto i) {
+				auto& column = std::get<decltype(i)::value>(m_fields);
+				column.insert(column.end(), count, component.*std::get<decltype(i)::value>(layout::members));
+			});
+		}
+
+		void copy(component_storage& destination, const std::size_t index) override
+		{
+			auto& other = static_cast<component_storage_impl&>(destination);
+			for_each_field([&](auto i) {
+				std::get<decltype(i)::value>(other.m_fields).back() = std::get<decltype(i)::value>(m_fields)[index];
+			});
+		}
+
+		void move(component_storage& destination, const std::size_t index) override
+		{
+			auto& other = static_cast<component_storage_impl&>(destination);
+			for_each_field([&](auto i) {
+				std::get<decltype(i)::value>(other.m_fields).back() = std::move(std::get<decltype(i)::value>(m_fields)[index]);
+			});
+		}
+
+		inline std::size_t size() const override
+		{
+			return std::get<0>(m_fields).size();
+		}
+
+		inline std::size_t capacity() const override
+		{
+			return std::get<0>(m_fields).capacity();
+		}
+
+		void shrink_to_fit() override
+		{
+			for_each_field([this](auto i) {
+				std::get<decltype(i)::value>(m_fields).shrink_to_fit();
+			});
+		}
+
+		inline std::size_t element_size() const override
+		{
+			return sizeof(Component);
+		}
+
+		inline bool trivially_copyable() const override
+		{
+			return false;
+		}
+
+		const void* data() const override
+		{
+			return nullptr;
+		}
+
+		void assign(const void* data, const std::size_t count) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				for_each_field([&](auto i) {
+					std::get<decltype(i)::value>(m_fields).resize(count);
+				});
+				for (std::size_t index = 0; index < count; ++index)
+					assign_at(index, static_cast<const std::byte*>(data) + index * sizeof(Component));
+			}
+		}
+
+		void assign_at(const std::size_t index, const void* data) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				Component component;
+				std::memcpy(&component, data, sizeof(Component));
+				scatter(index, component);
+			}
+		}
+
+		std::shared_ptr<const void> clone_range(const std::size_t begin, const std::size_t count) const override
+		{
+			auto components = std::make_shared<std::vector<Component>>();
+			components->reserve(count);
+			for (std::size_t index = begin; index < begin + count; ++index)
+				components->push_back(gather(index));
+			return components;
+		}
+
+		inline bool pageable() const override
+		{
+			return std::is_trivially_copyable<Component>::value;
+		}
+
+		std::size_t page_bytes(const std::size_t count) const override
+		{
+			std::size_t bytes = 0;
+			for_each_field([&](auto i) {
+				bytes += count * sizeof(typename std::tuple_element_t<decltype(i)::value, typename layout::columns>::value_type);
+			});
+			return bytes;
+		}
+
+		// fields one after the other
+		void page_out(std::byte* destination) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				for_each_field([&](auto i) {
+					auto& column = std::get<decltype(i)::value>(m_fields);
+					const std::size_t bytes = column.size() * sizeof(typename std::remove_reference_t<decltype(column)>::value_type);
+					if (bytes)
+						std::memcpy(destination, column.data(), bytes);
+					destination += bytes;
+					std::remove_reference_t<decltype(column)>(column.get_allocator()).swap(column);
+				});
+			}
+		}
+
+		void page_in(const std::byte* source, const std::size_t count) override
+		{
+			if constexpr (std::is_trivially_copyable<Component>::value)
+			{
+				for_each_field([&](auto i) {
+					auto& column = std::get<decltype(i)::value>(m_fields);
+					const std::size_t bytes = count * sizeof(typename std::remove_reference_t<decltype(column)>::value_type);
+					column.resize(count);
+					if (bytes)
+						std::memcpy(column.data(), source, bytes);
+					source += bytes;
+				});
+			}
+		}
+	};
+
+	template <typename Component>
+	class soa_ref
+	{
+	private:
+		component_storage_impl<Component>* m_storage;
+		std::size_t m_index;
+	public:
+		soa_ref(component_storage_impl<Component>* storage, const std::size_t index)
+			: m_storage(storage), m_index(index)
+		{
+		}
+
+		template <auto Field>
+		auto& get() const
+		{
+			return m_storage->template field<Field>()[m_index];
+		}
+
+		operator Component() const
+		{
+			return m_storage->gather(m_index);
+		}
+
+		soa_ref& operator=(const Component& component)
+		{
+			m_storage->scatter(m_index, component);
+			return *this;
+		}
+	};
+	template <typename Component>
+	class soa_span
+	{
+	public:
+		using element_type = Component;
+	private:
+		component_storage_impl<Component>* m_storage;
+		std::size_t m_begin;
+		std::size_t m_size;
+	public:
+		soa_span(component_storage_impl<Component>* storage, const std::size_t begin, const std::size_t size)
+			: m_storage(storage), m_begin(begin), m_size(size)
+		{
+		}
+
+		inline std::size_t size() const
+		{
+			return m_size;
+		}
+
+		template <auto Field>
+		auto get() const
+		{
+			auto& column = m_storage->template field<Field>();
+			return span<typename member_pointer_traits<decltype(Field)>::member_type>(column.data() + m_begin, m_size);
+		}
+
+		soa_ref<Component> operator[](const std::size_t index) const
+		{
+			return soa_ref<Component>(m_storage, m_begin + index);
+		}
 	};
 }
 
-#endif // !APOLLO_COMPONENT_STORAGE_H
\ No newline at end of file
+#endif // !APOLLO_COMPONENT_STORAGE_H
@@ -0,0 +1,137 @@
+#ifndef APOLLO_CORE_MAPPED_FILE_H
+#define APOLLO_CORE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace apollo
+{
+	class mapped_file
+	{
+	private:
+		const std::byte* m_data = nullptr;
+		std::size_t m_size = 0;
+#if defined(_WIN32)
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	public:
+		mapped_file() = default;
+
+		explicit mapped_file(const std::string& path)
+		{
+			open(path);
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		~mapped_file()
+		{
+			close();
+		}
+
+		bool open(const std::string& path)
+		{
+			close();
+#if defined(_WIN32)
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+			{
+				close();
+				return false;
+			}
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_mapping)
+			{
+				close();
+				return false;
+			}
+			m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+			m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+			m_file = ::open(path.c_str(), O_RDONLY);
+			if (m_file == -1)
+				return false;
+			struct stat st;
+			if (fstat(m_file, &st) != 0 || st.st_size == 0)
+			{
+				close();
+				return false;
+			}
+			void* data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+			if (data == MAP_FAILED)
+			{
+				close();
+				return false;
+			}
+			// the whole file is consumed front to back exactly once
+			madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+			m_data = static_cast<const std::byte*>(data);
+			m_size = static_cast<std::size_t>(st.st_size);
+#endif
+			if (!m_data)
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+#if defined(_WIN32)
+			if (m_data)
+				UnmapViewOfFile(m_data);
+			if (m_mapping)
+				CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_data)
+				munmap(const_cast<std::byte*>(m_data), m_size);
+			if (m_file != -1)
+				::close(m_file);
+			m_file = -1;
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		inline bool valid() const
+		{
+			return m_data != nullptr;
+		}
+
+		inline const std::byte* data() const
+		{
+			return m_data;
+		}
+
+		inline std::size_t size() const
+		{
+			return m_size;
+		}
+	};
+}
+
+#endif // !APOLLO_CORE_MAPPED_FILE_H
@@ -0,0 +1,62 @@
+#ifndef APOLLO_CORE_SPAN_H
+#define APOLLO_CORE_SPAN_H
+
+#include <cstddef>
+
+namespace apollo
+{
+	// Pointer and length over contiguous column data, stands in for std::span until C++20.
+	template <typename T>
+	class span
+	{
+	public:
+		using element_type = T;
+	private:
+		T* m_data = nullptr;
+		std::size_t m_size = 0;
+	public:
+		span() = default;
+
+		span(T* data, const std::size_t size)
+			: m_data(data), m_size(size)
+		{
+		}
+
+		inline T* data() const
+		{
+			return m_data;
+		}
+
+		inline std::size_t size() const
+		{
+			return m_size;
+		}
+
+		inline bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		inline T* begin() const
+		{
+			return m_data;
+		}
+
+		inline T* end() const
+		{
+			return m_data + m_size;
+		}
+
+		inline T& operator[](const std::size_t index) const
+		{
+			return m_data[index];
+		}
+
+		span subspan(const std::size_t offset, const std::size_t count) const
+		{
+			return span(m_data + offset, count);
+		}
+	};
+}
+
+#endif // !APOLLO_CORE_SPAN_H
@@ -0,0 +1,130 @@
+#ifndef APOLLO_CORE_SPARSE_BITSET_H
+#define APOLLO_CORE_SPARSE_BITSET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace apollo
+{
+	// Bitset over a large, sparsely used index space. Pages are allocated on
+	// first use and only pages touched since the last clear() are visited, so
+	// iterating and clearing cost O(touched pages) rather than O(capacity).
+	class sparse_bitset
+	{
+	public:
+		static constexpr std::size_t page_bits = 4096;
+	private:
+		static constexpr std::size_t words_per_page = page_bits / 64;
+
+		std::vector<std::unique_ptr<std::uint64_t[]>> m_pages;
+		std::vector<bool> m_touched;
+		// pages holding bits set since the last clear(), in first-touch order
+		std::vector<std::size_t> m_touched_pages;
+		std::size_t m_count = 0;
+	public:
+		// Returns false when the bit was already set.
+		bool set(const std::size_t index)
+		{
+			const std::size_t page = index / page_bits;
+			if (m_pages.size() <= page)
+			{
+				m_pages.resize(page + 1);
+				m_touched.resize(page + 1, false);
+			}
+			if (!m_pages[page])
+				m_pages[page] = std::make_unique<std::uint64_t[]>(words_per_page);
+			if (!m_touched[page])
+			{
+				m_touched[page] = true;
+				m_touched_pages.push_back(page);
+			}
+			std::uint64_t& word = m_pages[page][(index % page_bits) / 64];
+			const std::uint64_t mask = std::uint64_t(1) << (index % 64);
+			if (word & mask)
+				return false;
+			word |= mask;
+			++m_count;
+			return true;
+		}
+
+		// Returns false when the bit was not set.
+		bool reset(const std::size_t index)
+		{
+			if (!test(index))
+				return false;
+			m_pages[index / page_bits][(index % page_bits) / 64] &= ~(std::uint64_t(1) << (index % 64));
+			--m_count;
+			return true;
+		}
+
+		bool test(const std::size_t index) const
+		{
+			const std::size_t page = index / page_bits;
+			if (page >= m_pages.size() || !m_pages[page])
+				return false;
+			return (m_pages[page][(index % page_bits) / 64] >> (index % 64)) & 1;
+		}
+
+		inline std::size_t size() const
+		{
+			return m_count;
+		}
+
+		inline bool empty() const
+		{
+			return m_count == 0;
+		}
+
+		// Calls fn(index) for every set bit in ascending order.
+		template <typename Fn>
+		void for_each(Fn&& fn)
+		{
+			std::sort(m_touched_pages.begin(), m_touched_pages.end());
+			for (std::size_t page : m_touched_pages)
+			{
+				const std::uint64_t* words = m_pages[page].get();
+				for (std::size_t w = 0; w < words_per_page; ++w)
+				{
+					std::uint64_t word = words[w];
+					while (word)
+					{
+						const std::size_t bit = count_trailing_zeros(word);
+						fn(page * page_bits + w * 64 + bit);
+						word &= word - 1;
+					}
+				}
+			}
+		}
+
+		// Zeroes the touched pages and keeps them allocated for reuse.
+		void clear()
+		{
+			for (std::size_t page : m_touched_pages)
+			{
+				std::fill(m_pages[page].get(), m_pages[page].get() + words_per_page, 0);
+				m_touched[page] = false;
+			}
+			m_touched_pages.clear();
+			m_count = 0;
+		}
+	private:
+		static inline std::size_t count_trailing_zeros(std::uint64_t word)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_ctzll(word);
+#else
+			std::size_t count = 0;
+			while (!(word & 1))
+			{
+				word >>= 1;
+				++count;
+			}
+			return count;
+#endif
+		}
+	};
+}
+
+#endif // !APOLLO_CORE_SPARSE_BITSET_H
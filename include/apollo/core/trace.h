@@ -0,0 +1,247 @@
+#ifndef APOLLO_CORE_TRACE_H
+#define APOLLO_CORE_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#if defined(__GNUG__)
+#include <cstdlib>
+#include <cxxabi.h>
+#endif
+
+namespace apollo
+{
+	struct trace_event
+	{
+		const char* m_name;
+		const char* m_category;
+		std::uint64_t m_begin;
+		std::uint64_t m_end;
+	};
+
+	// Single producer (the owning thread), single consumer (the tracer when
+	// collecting). Events are dropped rather than blocking when it is full.
+	class trace_buffer
+	{
+	public:
+		static constexpr std::size_t capacity = 1 << 16;
+	private:
+		std::array<trace_event, capacity> m_events;
+		std::atomic<std::uint64_t> m_head{ 0 };
+		std::atomic<std::uint64_t> m_tail{ 0 };
+		std::atomic<std::uint64_t> m_dropped{ 0 };
+		std::size_t m_thread_index;
+	public:
+		explicit trace_buffer(const std::size_t thread_index)
+			: m_thread_index(thread_index)
+		{
+		}
+
+		inline std::size_t get_thread_index() const
+		{
+			return m_thread_index;
+		}
+
+		inline std::uint64_t get_dropped() const
+		{
+			return m_dropped.load(std::memory_order_relaxed);
+		}
+
+		void push(const trace_event& event)
+		{
+			const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) >= capacity)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_events[head % capacity] = event;
+			m_head.store(head + 1, std::memory_order_release);
+		}
+
+		template <typename Fn>
+		void drain(Fn&& fn)
+		{
+			const std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+			const std::uint64_t head = m_head.load(std::memory_order_acquire);
+			for (std::uint64_t i = tail; i < head; ++i)
+				fn(m_events[i % capacity]);
+			m_tail.store(head, std::memory_order_release);
+		}
+	};
+
+	// Readable name of a type for trace events, demangled once and kept for the
+	// lifetime of the program so events can refer to it.
+	inline const char* trace_type_name(const std::type_info& type)
+	{
+		static std::mutex s_mutex;
+		static std::unordered_map<std::type_index, std::string> s_names;
+		std::lock_guard<std::mutex> lock(s_mutex);
+		auto it = s_names.find(type);
+		if (it == s_names.end())
+		{
+			std::string name = type.name();
+#if defined(__GNUG__)
+			int status = 0;
+			char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+			if (status == 0 && demangled)
+				name = demangled;
+			std::free(demangled);
+#endif
+			it = s_names.emplace(type, std::move(name)).first;
+		}
+		return it->second.c_str();
+	}
+
+	class tracer
+	{
+	private:
+		struct collected_event
+		{
+			trace_event m_event;
+			std::size_t m_thread_index;
+		};
+
+		std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<trace_buffer>> m_buffers;
+		std::vector<collected_event> m_collected;
+	private:
+		tracer() = default;
+
+		trace_buffer* register_thread()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_buffers.push_back(std::make_unique<trace_buffer>(m_buffers.size()));
+			return m_buffers.back().get();
+		}
+
+		static void write_json_string(std::ostream& out, const char* text)
+		{
+			static const char hex[] = "0123456789abcdef";
+			out << '"';
+			for (const char* c = text; *c; ++c)
+			{
+				const unsigned char u = static_cast<unsigned char>(*c);
+				if (u == '"' || u == '\\')
+					out << '\\' << *c;
+				else if (u < 0x20)
+					out << "\\u00" << hex[u >> 4] << hex[u & 0xf];
+				else
+					out << *c;
+			}
+			out << '"';
+		}
+	public:
+		static tracer& instance()
+		{
+			static tracer s_tracer;
+			return s_tracer;
+		}
+
+		inline std::uint64_t now() const
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+		}
+
+		trace_buffer& get_thread_buffer()
+		{
+			thread_local trace_buffer* t_buffer = register_thread();
+			return *t_buffer;
+		}
+
+		void record(const char* name, const char* category, const std::uint64_t begin, const std::uint64_t end)
+		{
+			get_thread_buffer().push({ name, category, begin, end });
+		}
+
+		// Moves pending events out of the per-thread buffers; call it once per
+		// frame so long captures do not overflow them.
+		void collect()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& buffer : m_buffers)
+			{
+				const std::size_t thread_index = buffer->get_thread_index();
+				buffer->drain([this, thread_index](const trace_event& event) {
+					m_collected.push_back({ event, thread_index });
+				});
+			}
+		}
+
+		void clear()
+		{
+			collect();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_collected.clear();
+		}
+
+		void export_chrome_trace(std::ostream& out)
+		{
+			collect();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			out << "{\"traceEvents\":[";
+			for (std::size_t i = 0; i < m_collected.size(); ++i)
+			{
+				const collected_event& e = m_collected[i];
+				out << (i ? ",\n" : "\n") << "{\"name\":";
+				write_json_string(out, e.m_event.m_name);
+				out << ",\"cat\":";
+				write_json_string(out, e.m_event.m_category);
+				out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.m_thread_index
+					<< ",\"ts\":" << e.m_event.m_begin / 1000.0
+					<< ",\"dur\":" << (e.m_event.m_end - e.m_event.m_begin) / 1000.0 << "}";
+			}
+			out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		}
+
+		bool export_chrome_trace(const std::string& path)
+		{
+			std::ofstream out(path, std::ios::trunc);
+			if (!out)
+				return false;
+			export_chrome_trace(out);
+			return out.good();
+		}
+	};
+
+	class trace_scope
+	{
+	private:
+		const char* m_name;
+		const char* m_category;
+		std::uint64_t m_begin;
+	public:
+		trace_scope(const char* name, const char* category)
+			: m_name(name), m_category(category), m_begin(tracer::instance().now())
+		{
+		}
+
+		~trace_scope()
+		{
+			tracer& t = tracer::instance();
+			t.record(m_name, m_category, m_begin, t.now());
+		}
+	};
+}
+
+#define APOLLO_TRACE_CONCAT_IMPL(a, b) a##b
+#define APOLLO_TRACE_CONCAT(a, b) APOLLO_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef APOLLO_ENABLE_TRACING
+#define APOLLO_TRACE_SCOPE(name, category) ::apollo::trace_scope APOLLO_TRACE_CONCAT(apollo_trace_scope_, __LINE__)(name, category)
+#else
+#define APOLLO_TRACE_SCOPE(name, category) ((void)0)
+#endif
+
+#endif // !APOLLO_CORE_TRACE_H
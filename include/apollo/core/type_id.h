@@ -0,0 +1,94 @@
+#ifndef APOLLO_CORE_TYPE_ID_H
+#define APOLLO_CORE_TYPE_ID_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace apollo
+{
+	template <typename T>
+	constexpr std::string_view type_name()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		constexpr std::string_view signature = __FUNCSIG__;
+		constexpr std::size_t begin = signature.find("type_name<") + 10;
+		constexpr std::size_t end = signature.rfind(">(void)");
+		std::string_view name = signature.substr(begin, end - begin);
+		for (std::string_view prefix : { std::string_view("struct "), std::string_view("class "), std::string_view("enum ") })
+		{
+			if (name.substr(0, prefix.size()) == prefix)
+				name.remove_prefix(prefix.size());
+		}
+		return name;
+#else
+		constexpr std::string_view signature = __PRETTY_FUNCTION__;
+		constexpr std::size_t begin = signature.find("T = ") + 4;
+		constexpr std::size_t end = signature.find_first_of(";]", begin);
+		return signature.substr(begin, end - begin);
+#endif
+	}
+
+	constexpr std::uint64_t fnv1a(const std::string_view value)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (char c : value)
+		{
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Stable across builds and processes as long as the type keeps its name,
+	// unlike component<T>::id which is a dense per-process slot.
+	template <typename T>
+	constexpr std::uint64_t type_hash()
+	{
+		return fnv1a(type_name<T>());
+	}
+
+	constexpr std::uint64_t type_mask_bit(const std::uint64_t hash)
+	{
+		return std::uint64_t(1) << (hash % 64);
+	}
+
+	template <typename... Ts>
+	struct type_list_signature
+	{
+		static constexpr std::size_t size = sizeof...(Ts);
+
+		// Bloom-style mask, a superset test on it rejects most archetypes without touching their signature.
+		static constexpr std::uint64_t mask = (type_mask_bit(type_hash<Ts>()) | ... | std::uint64_t(0));
+
+		static constexpr std::array<std::uint64_t, sizeof...(Ts)> sorted_hashes()
+		{
+			std::array<std::uint64_t, sizeof...(Ts)> hashes{ type_hash<Ts>()... };
+			for (std::size_t i = 1; i < hashes.size(); ++i)
+			{
+				for (std::size_t j = i; j > 0 && hashes[j - 1] > hashes[j]; --j)
+				{
+					const std::uint64_t t = hashes[j - 1];
+					hashes[j - 1] = hashes[j];
+					hashes[j] = t;
+				}
+			}
+			return hashes;
+		}
+
+		static constexpr std::array<std::uint64_t, sizeof...(Ts)> hashes = sorted_hashes();
+	private:
+		template <typename T>
+		static constexpr bool collides_with_any()
+		{
+			return ((!std::is_same<T, Ts>::value && type_hash<T>() == type_hash<Ts>()) || ...);
+		}
+	public:
+		// Distinct types of the list with the same hash; repeating a type is fine.
+		static constexpr bool collision_free = !(collides_with_any<Ts>() || ...);
+	};
+}
+
+#endif // !APOLLO_CORE_TYPE_ID_H
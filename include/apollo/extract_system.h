@@ -0,0 +1,21 @@
+#ifndef APOLLO_EXTRACT_SYSTEM_H
+#define APOLLO_EXTRACT_SYSTEM_H
+
+#include "world_view.h"
+
+namespace apollo
+{
+	// Read-only tail work of a frame (metrics, export, render extraction). Runs
+	// after every system against the world_view of its frame; with a pipeline
+	// depth above one it overlaps the next frames. Extract systems run in
+	// creation order and frames reach each of them in order.
+	class extract_system
+	{
+	public:
+		virtual ~extract_system() = default;
+
+		virtual void update(const world_view& view) = 0;
+	};
+}
+
+#endif // !APOLLO_EXTRACT_SYSTEM_H
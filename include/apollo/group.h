@@ -0,0 +1,123 @@
+#ifndef APOLLO_GROUP_H
+#define APOLLO_GROUP_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "archetype.h"
+#include "memory/group_arena.h"
+
+namespace apollo
+{
+	class group_base
+	{
+	public:
+		virtual ~group_base() = default;
+		virtual void try_adopt(archetype& archetype) = 0;
+		virtual void clear_members() = 0;
+		virtual void maintain() = 0;
+	};
+
+	// Owning group: the Owned columns of every archetype holding all of them
+	// live back to back in one arena per component, in member order, each with
+	// headroom for rows added after packing. An archetype is owned by the first
+	// group that adopts it; later groups still list it as a member but leave
+	// its columns alone.
+	template <typename... Owned>
+	class group : public group_base
+	{
+		static_assert(sizeof...(Owned) > 0, "a group must own at least one component");
+	private:
+		std::pmr::memory_resource* m_upstream;
+		std::vector<archetype*> m_members;
+		std::array<std::unique_ptr<group_arena>, sizeof...(Owned)> m_arenas;
+		bool m_dirty = false;
+	private:
+		// rows a packed column can take before it outgrows its place in the arena
+		static inline std::size_t reserved(const std::size_t size)
+		{
+			return size + std::max<std::size_t>(size / 2, 16);
+		}
+
+		// Moves the owned columns of every member into fresh arenas in one sweep over
+		// the members, each column followed by headroom for rows added later.
+		void pack()
+		{
+			std::array<std::size_t, sizeof...(Owned)> bytes{};
+			for (archetype* member : m_members)
+			{
+				if (member->get_group() != this)
+					continue;
+				const std::size_t capacity = reserved(member->get_entities().size());
+				std::size_t i = 0;
+				((bytes[i++] += capacity * sizeof(Owned) + alignof(std::max_align_t)), ...);
+			}
+			std::array<std::unique_ptr<group_arena>, sizeof...(Owned)> arenas;
+			for (std::size_t i = 0; i < arenas.size(); ++i)
+				arenas[i] = std::make_unique<group_arena>(bytes[i], m_upstream);
+			for (archetype* member : m_members)
+			{
+				if (member->get_group() != this)
+					continue;
+				const std::size_t capacity = reserved(member->get_entities().size());
+				std::size_t i = 0;
+				((member->relocate_storage(Owned::id, arenas[i++].get(), capacity)), ...);
+			}
+			m_arenas = std::move(arenas);
+		}
+	public:
+		explicit group(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: m_upstream(upstream)
+		{
+		}
+
+		inline const std::vector<archetype*>& get_members() const
+		{
+			return m_members;
+		}
+
+		std::size_t size() const
+		{
+			std::size_t size = 0;
+			for (const archetype* member : m_members)
+				size += member->get_entities().size();
+			return size;
+		}
+
+		void try_adopt(archetype& archetype) override
+		{
+			if (!archetype.has_all<Owned...>())
+				return;
+			m_members.push_back(&archetype);
+			if (!archetype.get_group())
+			{
+				archetype.set_group(this);
+				m_dirty = true;
+			}
+		}
+
+		void clear_members() override
+		{
+			m_members.clear();
+		}
+
+		// Repacks after adoptions, and once a column outgrew its headroom and
+		// reallocated away from the others.
+		void maintain() override
+		{
+			const bool grown = std::any_of(m_arenas.begin(), m_arenas.end(), [](const auto& arena) {
+				return arena && arena->wasted();
+			});
+			if (m_dirty || grown)
+				pack();
+			m_dirty = false;
+		}
+	};
+}
+
+#endif // !APOLLO_GROUP_H
@@ -0,0 +1,151 @@
+#ifndef APOLLO_INDEX_H
+#define APOLLO_INDEX_H
+
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "archetype.h"
+#include "soa.h"
+
+namespace apollo
+{
+	class index_base
+	{
+	public:
+		virtual ~index_base() = default;
+		virtual void insert_row(archetype& archetype, const std::size_t row) = 0;
+		virtual void erase(const entity entity) = 0;
+		virtual void rebuild(const std::vector<archetype_ptr>& archetypes) = 0;
+	};
+
+	// Maps the value of one component field to the entities holding it. Kept up
+	// to date by the registry through emplace, replace, patch, remove and
+	// destroy; writes through for_each or get references are not seen.
+	template <typename Map, auto Field>
+	class basic_index : public index_base
+	{
+	public:
+		using component_type = typename member_pointer_traits<decltype(Field)>::class_type;
+		using key_type = typename member_pointer_traits<decltype(Field)>::member_type;
+		using iterator = typename Map::const_iterator;
+
+		static_assert(!is_soa<component_type>::value, "indexed components must not use SoA storage");
+	protected:
+		Map m_entries;
+		// indexed key of every entity, by entity; iterators into m_entries would not
+		// survive a rehash
+		std::vector<std::optional<key_type>> m_keys;
+	private:
+		void erase_entry(const entity entity, const key_type& key)
+		{
+			auto range = m_entries.equal_range(key);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (it->second == entity)
+				{
+					m_entries.erase(it);
+					return;
+				}
+			}
+		}
+	public:
+		void insert(const entity entity, const component_type& component)
+		{
+			if (m_keys.size() <= entity)
+				m_keys.resize(entity + 1);
+			auto& key = m_keys[entity];
+			if (key)
+			{
+				if (*key == component.*Field)
+					return;
+				erase_entry(entity, *key);
+			}
+			key = component.*Field;
+			m_entries.emplace(*key, entity);
+		}
+
+		void insert_row(archetype& archetype, const std::size_t row) override
+		{
+			if (archetype.template has_all<component_type>())
+				insert(archetype.get_entities()[row], (*archetype.template get_components<component_type>())[row]);
+		}
+
+		void erase(const entity entity) override
+		{
+			if (entity >= m_keys.size() || !m_keys[entity])
+				return;
+			erase_entry(entity, *m_keys[entity]);
+			m_keys[entity].reset();
+		}
+
+		void rebuild(const std::vector<archetype_ptr>& archetypes) override
+		{
+			m_entries.clear();
+			m_keys.clear();
+			for (const auto& archetype : archetypes)
+			{
+				for (std::size_t row = 0; row < archetype->get_entities().size(); ++row)
+					insert_row(*archetype, row);
+			}
+		}
+
+		inline std::size_t size() const
+		{
+			return m_entries.size();
+		}
+
+		inline std::pair<iterator, iterator> equal_range(const key_type& key) const
+		{
+			return m_entries.equal_range(key);
+		}
+
+		// Returns an entity whose field equals key, or invalid_index.
+		entity find(const key_type& key) const
+		{
+			auto it = m_entries.find(key);
+			return it != m_entries.end() ? it->second : invalid_index;
+		}
+
+		inline std::size_t count(const key_type& key) const
+		{
+			return m_entries.count(key);
+		}
+	};
+
+	// Equality lookups in O(1).
+	template <auto Field>
+	class hash_index : public basic_index<std::unordered_multimap<typename member_pointer_traits<decltype(Field)>::member_type, entity>, Field>
+	{
+	};
+
+	// Equality and range lookups in O(log n), iterated in key order.
+	template <auto Field>
+	class ordered_index : public basic_index<std::multimap<typename member_pointer_traits<decltype(Field)>::member_type, entity>, Field>
+	{
+	private:
+		using base = basic_index<std::multimap<typename member_pointer_traits<decltype(Field)>::member_type, entity>, Field>;
+	public:
+		using typename base::iterator;
+		using typename base::key_type;
+
+		// Entries with first <= key < last.
+		inline std::pair<iterator, iterator> range(const key_type& first, const key_type& last) const
+		{
+			return { this->m_entries.lower_bound(first), this->m_entries.lower_bound(last) };
+		}
+
+		inline iterator begin() const
+		{
+			return this->m_entries.begin();
+		}
+
+		inline iterator end() const
+		{
+			return this->m_entries.end();
+		}
+	};
+}
+
+#endif // !APOLLO_INDEX_H
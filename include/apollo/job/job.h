@@ -3,6 +3,7 @@
 
 #include "thread_pool.h"
 #include "job_handle.h"
+#include <atomic>
 #include <memory>
 #include <functional>
 
@@ -11,7 +12,7 @@ namespace apollo
 	class job
 	{
 	private:
-		inline static std::size_t ID = 0;
+		inline static std::atomic<std::size_t> ID = 0;
 		thread_pool* m_thread_pool;
 		std::function<void()> m_task;
 	public:
@@ -26,13 +27,31 @@ namespace apollo
 
 		template <typename... Handles, typename = std::enable_if_t<std::conjunction_v<std::is_same<job_handle, std::remove_cv_t<std::remove_reference_t<Handles>>>...>>>
 		job_handle schedule(Handles&&... handles)
+		{
+			return schedule(job_priority::normal, std::forward<Handles>(handles)...);
+		}
+
+		template <typename... Handles, typename = std::enable_if_t<std::conjunction_v<std::is_same<job_handle, std::remove_cv_t<std::remove_reference_t<Handles>>>...>>>
+		job_handle schedule(const job_priority priority, Handles&&... handles)
 		{
 			(..., handles.complete());
-			std::shared_future<void> future = m_thread_pool->enqueue(m_task);
+			std::shared_future<void> future = m_thread_pool->enqueue(priority, m_task);
 			m_handle = job_handle(future);
 			return m_handle;
 		}
 
+		// Schedules the task without waiting on anything and enqueues continuation
+		// on the same pool and lane once the task has run. The job is not touched after
+		// the task is enqueued, so continuation may destroy it; m_handle is left as is.
+		void schedule_then(std::function<void()> continuation, const job_priority priority = job_priority::normal)
+		{
+			thread_pool* pool = m_thread_pool;
+			pool->enqueue(priority, [task = m_task, pool, priority, continuation = std::move(continuation)]() {
+				task();
+				pool->enqueue(priority, continuation);
+			});
+		}
+
 		void run()
 		{
 			m_task();
@@ -0,0 +1,185 @@
+#ifndef APOLLO_JOB_TASK_H
+#define APOLLO_JOB_TASK_H
+
+#ifdef APOLLO_ENABLE_COROUTINES
+
+#include "job.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace apollo
+{
+	// Coroutine that starts eagerly and stays suspended at its end until the
+	// task is destroyed. Awaiting a job resumes it on a worker of the job's pool.
+	class task
+	{
+	public:
+		struct promise_type
+		{
+			std::atomic<bool> m_done{ false };
+
+			struct final_awaiter
+			{
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+				{
+					handle.promise().m_done.store(true, std::memory_order_release);
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+			};
+
+			task get_return_object()
+			{
+				return task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_never initial_suspend() const noexcept
+			{
+				return {};
+			}
+
+			final_awaiter final_suspend() const noexcept
+			{
+				return {};
+			}
+
+			void return_void() const
+			{
+			}
+
+			void unhandled_exception() const
+			{
+				std::terminate();
+			}
+		};
+	private:
+		std::coroutine_handle<promise_type> m_handle;
+	public:
+		task() = default;
+
+		explicit task(std::coroutine_handle<promise_type> handle)
+			: m_handle(handle)
+		{
+		}
+
+		task(task&& other) noexcept
+			: m_handle(std::exchange(other.m_handle, nullptr))
+		{
+		}
+
+		task& operator=(task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_handle)
+					m_handle.destroy();
+				m_handle = std::exchange(other.m_handle, nullptr);
+			}
+			return *this;
+		}
+
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+
+		~task()
+		{
+			if (m_handle)
+				m_handle.destroy();
+		}
+
+		// true once the coroutine has run to its end, from any thread
+		inline bool done() const
+		{
+			return !m_handle || m_handle.promise().m_done.load(std::memory_order_acquire);
+		}
+	};
+
+	class job_awaiter
+	{
+	private:
+		job& m_job;
+	public:
+		explicit job_awaiter(job& job)
+			: m_job(job)
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			m_job.schedule_then([handle]() {
+				handle.resume();
+			});
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	// co_await job schedules it and resumes once it has run.
+	inline job_awaiter operator co_await(job& job)
+	{
+		return job_awaiter(job);
+	}
+
+	template <typename... Jobs>
+	class when_all_awaiter
+	{
+	private:
+		std::tuple<Jobs&...> m_jobs;
+	public:
+		explicit when_all_awaiter(Jobs&... jobs)
+			: m_jobs(jobs...)
+		{
+		}
+
+		bool await_ready() const noexcept
+		{
+			return sizeof...(Jobs) == 0;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			auto remaining = std::make_shared<std::atomic<std::size_t>>(sizeof...(Jobs));
+			// the coroutine may resume before this returns, so members are not touched after scheduling
+			std::apply([&](auto&... jobs) {
+				(jobs.schedule_then([remaining, handle]() {
+					if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+						handle.resume();
+				}), ...);
+			}, std::tuple<Jobs&...>(m_jobs));
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	// Schedules every job and resumes once all of them have run.
+	template <typename... Jobs>
+	when_all_awaiter<Jobs...> when_all(Jobs&... jobs)
+	{
+		static_assert((std::is_same<job, Jobs>::value && ...), "when_all only accepts jobs");
+		return when_all_awaiter<Jobs...>(jobs...);
+	}
+}
+
+#endif // APOLLO_ENABLE_COROUTINES
+
+#endif // !APOLLO_JOB_TASK_H
@@ -1,30 +1,66 @@
 #ifndef APOLLO_JOB_THREAD_POOL_H
 #define APOLLO_JOB_THREAD_POOL_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <functional>
 #include <future>
 #include <memory>
+#include "../core/trace.h"
 #include <xenium/ramalhete_queue.hpp>
 #include <xenium/reclamation/generic_epoch_based.hpp>
 
 namespace apollo
 {
+	// Lanes of the pool, highest first. Workers always drain higher lanes first.
+	enum class job_priority : std::uint8_t
+	{
+		critical,
+		normal,
+		background
+	};
+
 	class thread_pool
 	{
 	public:
+		static constexpr std::size_t lanes = 3;
+
 		thread_pool(size_t);
 		template<class F, class... Args>
 		std::future<std::invoke_result_t<F, Args...>> enqueue(F&& f, Args&&... args);
+		template<class F, class... Args>
+		std::future<std::invoke_result_t<F, Args...>> enqueue(job_priority priority, F&& f, Args&&... args);
+		inline std::size_t size() const
+		{
+			return workers.size();
+		}
+		// Runs the queued tasks of lanes above the one of the task running on this thread,
+		// so long background work stays preemptible when called at chunk boundaries. A no-op
+		// outside of background and normal tasks of this pool. Preempting tasks run on this stack: they
+		// must not wait on the task they preempt. Returns whether any task ran.
+		bool preempt();
 		~thread_pool();
 	private:
-		bool m_stop;
-		std::vector<std::thread> workers;
-		xenium::ramalhete_queue<
+		typedef xenium::ramalhete_queue<
 			std::unique_ptr<std::function<void()>>,
 			xenium::policy::reclaimer<xenium::reclamation::epoch_based<>>,
 			xenium::policy::entries_per_node<2048>
-		> tasks;
+		> task_queue;
+
+		bool run_next(std::size_t lane_count);
+
+		std::atomic<bool> m_stop;
+		std::vector<std::thread> workers;
+		std::array<task_queue, lanes> tasks;
+		// pool and lane of the task running on this thread, none outside of tasks
+		struct running_task
+		{
+			const thread_pool* m_pool;
+			std::size_t m_lane;
+		};
+		inline static thread_local running_task t_running = { nullptr, 0 };
 	};
 
 	inline thread_pool::thread_pool(size_t threads)
@@ -36,12 +72,9 @@ namespace apollo
 				{
 					for (;;)
 					{
-						if (m_stop)
+						if (m_stop.load(std::memory_order_acquire))
 							return;
-						std::unique_ptr<std::function<void()>> task;
-						if (tasks.try_pop(task)) {
-							(*task)();
-						}
+						run_next(lanes);
 					}
 				}
 				);
@@ -49,6 +82,12 @@ namespace apollo
 
 	template<class F, class... Args>
 	std::future<std::invoke_result_t<F, Args...>> thread_pool::enqueue(F&& f, Args&&... args)
+	{
+		return enqueue(job_priority::normal, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	template<class F, class... Args>
+	std::future<std::invoke_result_t<F, Args...>> thread_pool::enqueue(job_priority priority, F&& f, Args&&... args)
 	{
 		using return_type = std::invoke_result_t<F, Args...>;
 
@@ -58,13 +97,39 @@ namespace apollo
 
 		std::future<return_type> res = task->get_future();
 
-		tasks.push(std::make_unique<std::function<void()>>([task]() { (*task)(); }));
+		tasks[static_cast<std::size_t>(priority)].push(std::make_unique<std::function<void()>>([task]() { (*task)(); }));
 		return res;
 	}
 
+	// Pops and runs one task from the first lane_count lanes, highest first.
+	inline bool thread_pool::run_next(std::size_t lane_count)
+	{
+		for (std::size_t lane = 0; lane < lane_count; ++lane)
+		{
+			std::unique_ptr<std::function<void()>> task;
+			if (tasks[lane].try_pop(task)) {
+				APOLLO_TRACE_SCOPE("job", "job");
+				const running_task previous = t_running;
+				t_running = { this, lane };
+				(*task)();
+				t_running = previous;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool thread_pool::preempt()
+	{
+		bool ran = false;
+		while (t_running.m_pool == this && run_next(t_running.m_lane))
+			ran = true;
+		return ran;
+	}
+
 	inline thread_pool::~thread_pool()
 	{
-		m_stop = true;
+		m_stop.store(true, std::memory_order_release);
 		for (std::thread& worker : workers)
 			worker.join();
 	}
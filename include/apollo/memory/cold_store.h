@@ -0,0 +1,238 @@
+#ifndef APOLLO_MEMORY_COLD_STORE_H
+#define APOLLO_MEMORY_COLD_STORE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../core/common.h"
+
+namespace apollo
+{
+	// Read-write memory-mapped backing file for the columns of cold archetypes.
+	// Extents are handed out first fit from a coalescing free list and the file
+	// grows by doubling; pointers into it are only valid until the next write().
+	// Written pages are dropped from the working set, so they only occupy the
+	// page cache until the OS writes them back.
+	class cold_store
+	{
+	public:
+		static constexpr std::size_t alignment = 64;
+	private:
+		std::byte* m_data = nullptr;
+		std::size_t m_capacity = 0;
+		std::size_t m_end = 0;
+		std::size_t m_used = 0;
+		// free extents below m_end, by offset
+		std::map<std::size_t, std::size_t> m_free;
+#if defined(_WIN32)
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	private:
+		static inline std::size_t round_up(const std::size_t bytes)
+		{
+			return (bytes + alignment - 1) & ~(alignment - 1);
+		}
+
+		void unmap()
+		{
+#if defined(_WIN32)
+			if (m_data)
+				UnmapViewOfFile(m_data);
+			if (m_mapping)
+				CloseHandle(m_mapping);
+			m_mapping = nullptr;
+#else
+			if (m_data)
+				munmap(m_data, m_capacity);
+#endif
+			m_data = nullptr;
+		}
+
+		bool grow(const std::size_t capacity)
+		{
+#if defined(_WIN32)
+			// a file with a mapped view cannot be resized
+			unmap();
+			LARGE_INTEGER size;
+			size.QuadPart = static_cast<LONGLONG>(capacity);
+			if (SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) && SetEndOfFile(m_file))
+				m_capacity = capacity;
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+			if (m_mapping)
+				m_data = static_cast<std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+			return m_data && m_capacity == capacity;
+#else
+			if (ftruncate(m_file, static_cast<off_t>(capacity)) != 0)
+				return false;
+			void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+			if (data == MAP_FAILED)
+				return false;
+			unmap();
+			m_data = static_cast<std::byte*>(data);
+			m_capacity = capacity;
+			return true;
+#endif
+		}
+
+		void evict(std::byte* data, const std::size_t size)
+		{
+#if defined(_WIN32)
+			// unlocking pages that are not locked drops them from the working set
+			VirtualUnlock(data, size);
+#else
+			const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+			const std::size_t first = (reinterpret_cast<std::size_t>(data) + page - 1) & ~(page - 1);
+			const std::size_t last = (reinterpret_cast<std::size_t>(data) + size) & ~(page - 1);
+			if (first < last)
+				madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+#endif
+		}
+	public:
+		cold_store() = default;
+
+		cold_store(const cold_store&) = delete;
+		cold_store& operator=(const cold_store&) = delete;
+
+		~cold_store()
+		{
+			close();
+		}
+
+		// Creates or truncates the backing file at path.
+		bool open(const std::string& path)
+		{
+			close();
+#if defined(_WIN32)
+			m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+				return false;
+#else
+			m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+			if (m_file == -1)
+				return false;
+#endif
+			return true;
+		}
+
+		void close()
+		{
+			unmap();
+#if defined(_WIN32)
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_file != -1)
+				::close(m_file);
+			m_file = -1;
+#endif
+			reset();
+			m_capacity = 0;
+		}
+
+		inline bool is_open() const
+		{
+#if defined(_WIN32)
+			return m_file != INVALID_HANDLE_VALUE;
+#else
+			return m_file != -1;
+#endif
+		}
+
+		// Reserves size bytes and returns their offset, or invalid_index when the
+		// file cannot grow. fill(std::byte*) writes them.
+		template <typename Fill>
+		std::size_t write(const std::size_t size, Fill&& fill)
+		{
+			const std::size_t bytes = round_up(size ? size : 1);
+			std::size_t offset = invalid_index;
+			for (auto it = m_free.begin(); it != m_free.end(); ++it)
+			{
+				if (it->second < bytes)
+					continue;
+				offset = it->first;
+				if (it->second > bytes)
+					m_free.emplace(it->first + bytes, it->second - bytes);
+				m_free.erase(it);
+				break;
+			}
+			if (offset == invalid_index)
+			{
+				if (m_end + bytes > m_capacity && !grow(std::max(m_end + bytes, m_capacity * 2)))
+					return invalid_index;
+				offset = m_end;
+				m_end += bytes;
+			}
+			fill(m_data + offset);
+			evict(m_data + offset, bytes);
+			m_used += bytes;
+			return offset;
+		}
+
+		inline const std::byte* data(const std::size_t offset) const
+		{
+			return m_data + offset;
+		}
+
+		void release(const std::size_t offset, const std::size_t size)
+		{
+			std::size_t first = offset;
+			std::size_t bytes = round_up(size ? size : 1);
+			m_used -= bytes;
+			auto next = m_free.lower_bound(first);
+			if (next != m_free.begin())
+			{
+				auto previous = std::prev(next);
+				if (previous->first + previous->second == first)
+				{
+					first = previous->first;
+					bytes += previous->second;
+					m_free.erase(previous);
+				}
+			}
+			if (next != m_free.end() && first + bytes == next->first)
+			{
+				bytes += next->second;
+				m_free.erase(next);
+			}
+			if (first + bytes == m_end)
+				m_end = first;
+			else
+				m_free.emplace(first, bytes);
+		}
+
+		// Forgets every extent, the file keeps its size.
+		void reset()
+		{
+			m_free.clear();
+			m_end = 0;
+			m_used = 0;
+		}
+
+		// Bytes held by live extents.
+		inline std::size_t size() const
+		{
+			return m_used;
+		}
+	};
+}
+
+#endif // !APOLLO_MEMORY_COLD_STORE_H
@@ -0,0 +1,92 @@
+#ifndef APOLLO_MEMORY_GROUP_ARENA_H
+#define APOLLO_MEMORY_GROUP_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace apollo
+{
+	// Bump allocator backing the owned columns of a group. Blocks are placed
+	// back to back and never reused; deallocations are only counted so the
+	// group knows when repacking into a fresh arena is worth it.
+	class group_arena : public std::pmr::memory_resource
+	{
+	private:
+		std::pmr::memory_resource* m_upstream;
+		std::vector<std::pair<void*, std::size_t>> m_regions;
+		std::byte* m_cursor = nullptr;
+		std::size_t m_remaining = 0;
+		std::size_t m_allocated = 0;
+		std::size_t m_freed = 0;
+	public:
+		explicit group_arena(const std::size_t initial_size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: m_upstream(upstream)
+		{
+			if (initial_size)
+				add_region(initial_size);
+		}
+
+		group_arena(const group_arena&) = delete;
+		group_arena& operator=(const group_arena&) = delete;
+
+		~group_arena()
+		{
+			for (auto& region : m_regions)
+				m_upstream->deallocate(region.first, region.second, alignof(std::max_align_t));
+		}
+
+		inline std::size_t live() const
+		{
+			return m_allocated - m_freed;
+		}
+
+		inline std::size_t wasted() const
+		{
+			return m_freed;
+		}
+
+		inline std::size_t num_regions() const
+		{
+			return m_regions.size();
+		}
+	private:
+		void add_region(const std::size_t size)
+		{
+			m_cursor = static_cast<std::byte*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+			m_remaining = size;
+			m_regions.emplace_back(m_cursor, size);
+		}
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(m_cursor) % alignment) % alignment;
+			if (!m_cursor || padding + bytes > m_remaining)
+			{
+				const std::size_t last = m_regions.empty() ? 0 : m_regions.back().second;
+				add_region(std::max(bytes + alignment, last * 2));
+				padding = (alignment - reinterpret_cast<std::uintptr_t>(m_cursor) % alignment) % alignment;
+			}
+			void* p = m_cursor + padding;
+			m_cursor += padding + bytes;
+			m_remaining -= padding + bytes;
+			m_allocated += bytes;
+			return p;
+		}
+
+		void do_deallocate(void*, std::size_t bytes, std::size_t) override
+		{
+			m_freed += bytes;
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+}
+
+#endif // !APOLLO_MEMORY_GROUP_ARENA_H
@@ -0,0 +1,98 @@
+#ifndef APOLLO_MEMORY_HUGE_PAGE_RESOURCE_H
+#define APOLLO_MEMORY_HUGE_PAGE_RESOURCE_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace apollo
+{
+	// Serves allocations of at least m_threshold bytes (large columns) straight
+	// from the OS in huge-page multiples; everything smaller goes upstream.
+	// On Windows large pages need SeLockMemoryPrivilege, so regular pages are
+	// committed instead.
+	class huge_page_resource : public std::pmr::memory_resource
+	{
+	public:
+		static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+	private:
+		std::size_t m_threshold;
+		std::pmr::memory_resource* m_upstream;
+	private:
+		static std::size_t round_up(const std::size_t bytes)
+		{
+			return (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+		}
+
+		inline bool is_large(const std::size_t bytes, const std::size_t alignment) const
+		{
+			return bytes >= m_threshold && alignment <= 4096;
+		}
+	public:
+		explicit huge_page_resource(const std::size_t threshold = huge_page_size, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: m_threshold(threshold), m_upstream(upstream)
+		{
+		}
+
+		huge_page_resource(const huge_page_resource&) = delete;
+		huge_page_resource& operator=(const huge_page_resource&) = delete;
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			if (!is_large(bytes, alignment))
+				return m_upstream->allocate(bytes, alignment);
+			const std::size_t size = round_up(bytes);
+#if defined(_WIN32)
+			void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (!p)
+				throw std::bad_alloc();
+#else
+			void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+			p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+			if (p == MAP_FAILED)
+			{
+				// no reserved huge pages, ask for transparent ones instead
+				p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (p == MAP_FAILED)
+					throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+				madvise(p, size, MADV_HUGEPAGE);
+#endif
+			}
+#endif
+			return p;
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			if (!is_large(bytes, alignment))
+			{
+				m_upstream->deallocate(p, bytes, alignment);
+				return;
+			}
+#if defined(_WIN32)
+			VirtualFree(p, 0, MEM_RELEASE);
+#else
+			munmap(p, round_up(bytes));
+#endif
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+}
+
+#endif // !APOLLO_MEMORY_HUGE_PAGE_RESOURCE_H
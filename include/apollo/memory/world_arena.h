@@ -0,0 +1,51 @@
+#ifndef APOLLO_MEMORY_WORLD_ARENA_H
+#define APOLLO_MEMORY_WORLD_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace apollo
+{
+	// A per-world arena: small blocks (entity arrays, edges, archetypes) are
+	// pooled and reused, everything is carved from monotonic chunks that are
+	// only returned upstream by release() or when the arena is destroyed.
+	// Not thread safe; structural changes of a registry are single threaded.
+	// The arena must outlive every registry that uses it.
+	class world_arena : public std::pmr::memory_resource
+	{
+	private:
+		std::pmr::monotonic_buffer_resource m_arena;
+		std::pmr::unsynchronized_pool_resource m_pool;
+	public:
+		explicit world_arena(const std::size_t initial_size = 1 << 20, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+			: m_arena(initial_size, upstream), m_pool(&m_arena)
+		{
+		}
+
+		world_arena(const world_arena&) = delete;
+		world_arena& operator=(const world_arena&) = delete;
+
+		void release()
+		{
+			m_pool.release();
+			m_arena.release();
+		}
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			return m_pool.allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			m_pool.deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+}
+
+#endif // !APOLLO_MEMORY_WORLD_ARENA_H
@@ -2,36 +2,65 @@
 #define APOLLO_OBSERVER_H
 
 #include "core/common.h"
+#include "core/span.h"
 #include <unordered_map>
 #include <functional>
 
 namespace apollo
 {
 	using Callback = std::function<void(registry&, entity const &)>;
+	using BatchCallback = std::function<void(registry&, span<const entity>)>;
 
 	class observer
 	{
 	private:
 		std::unordered_map<id_type, Callback> m_callbacks;
+		std::unordered_map<id_type, BatchCallback> m_batch_callbacks;
+	private:
+		static id_type next_id()
+		{
+			static id_type id = 0;
+			return id++;
+		}
 	public:
 		id_type connect(Callback&& callback)
 		{
-			static id_type id = 0;
+			id_type id = next_id();
 			m_callbacks[id] = std::move(callback);
-			return id++;
+			return id;
+		}
+
+		// Called once per bulk operation with every entity it touched.
+		id_type connect_batch(BatchCallback&& callback)
+		{
+			id_type id = next_id();
+			m_batch_callbacks[id] = std::move(callback);
+			return id;
 		}
 
 		void disconnect(id_type id)
 		{
-			auto it = m_callbacks.find(id);
-			if (it != m_callbacks.end())
-				m_callbacks.erase(id);
+			m_callbacks.erase(id);
+			m_batch_callbacks.erase(id);
 		}
 
 		void notify(registry& r, entity const & e)
 		{
 			for (auto& callback : m_callbacks)
 				callback.second.operator()(r, e);
+			for (auto& callback : m_batch_callbacks)
+				callback.second.operator()(r, span<const entity>(&e, 1));
+		}
+
+		void notify_batch(registry& r, span<const entity> entities)
+		{
+			for (auto& callback : m_batch_callbacks)
+				callback.second.operator()(r, entities);
+			for (auto& callback : m_callbacks)
+			{
+				for (const entity& e : entities)
+					callback.second.operator()(r, e);
+			}
 		}
 	};
 }
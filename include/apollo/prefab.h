@@ -0,0 +1,42 @@
+#ifndef APOLLO_PREFAB_H
+#define APOLLO_PREFAB_H
+
+#include "component.h"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace apollo
+{
+	// Component values to instantiate many entities from. Unlike a prefab
+	// entity it lives outside the registry, so queries never see it.
+	template <typename... TComponents>
+	class prefab
+	{
+		static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+		static_assert(sizeof...(TComponents) > 0, "a prefab must hold at least one component");
+	private:
+		std::tuple<TComponents...> m_components;
+	public:
+		prefab() = default;
+
+		explicit prefab(TComponents... components)
+			: m_components(std::move(components)...)
+		{
+		}
+
+		template <typename Component>
+		Component& get()
+		{
+			return std::get<Component>(m_components);
+		}
+
+		template <typename Component>
+		const Component& get() const
+		{
+			return std::get<Component>(m_components);
+		}
+	};
+}
+
+#endif // !APOLLO_PREFAB_H
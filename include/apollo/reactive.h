@@ -0,0 +1,73 @@
+#ifndef APOLLO_REACTIVE_H
+#define APOLLO_REACTIVE_H
+
+#include <functional>
+#include <vector>
+#include "core/common.h"
+#include "core/span.h"
+#include "core/sparse_bitset.h"
+
+namespace apollo
+{
+	class reactive_base
+	{
+	protected:
+		sparse_bitset m_pending;
+		std::vector<entity> m_entities;
+		// set by the registry: entity is alive and still holds the watched components
+		std::function<bool(entity)> m_matches;
+	public:
+		virtual ~reactive_base() = default;
+
+		inline void mark(const entity entity)
+		{
+			m_pending.set(entity);
+		}
+
+		inline void unmark(const entity entity)
+		{
+			m_pending.reset(entity);
+		}
+
+		inline void set_filter(std::function<bool(entity)>&& matches)
+		{
+			m_matches = std::move(matches);
+		}
+
+		// Entities marked since the last collect(), duplicates included once.
+		inline std::size_t pending() const
+		{
+			return m_pending.size();
+		}
+
+		// Returns the entities constructed or updated since the last call that are
+		// still alive and hold every watched component, in ascending order, and
+		// starts a new run. The span stays valid until the next call.
+		span<const entity> collect()
+		{
+			m_entities.clear();
+			m_entities.reserve(m_pending.size());
+			m_pending.for_each([this](const std::size_t e) {
+				if (m_matches(e))
+					m_entities.push_back(e);
+			});
+			m_pending.clear();
+			return span<const entity>(m_entities.data(), m_entities.size());
+		}
+
+		void clear()
+		{
+			m_pending.clear();
+		}
+	};
+
+	// Change set of the entities holding all of Components, fed by the
+	// registry's construct, update and destroy events.
+	template <typename... Components>
+	class reactive : public reactive_base
+	{
+		static_assert(sizeof...(Components) > 0, "reactive must watch at least one component");
+	};
+}
+
+#endif // !APOLLO_REACTIVE_H
@@ -0,0 +1,37 @@
+#ifndef APOLLO_REACTIVE_SYSTEM_H
+#define APOLLO_REACTIVE_SYSTEM_H
+
+#include "registry.h"
+#include "system.h"
+#include "reactive.h"
+
+namespace apollo
+{
+	// System that runs only on the entities holding all of Components that were
+	// constructed or updated since its last update, so it costs O(changes)
+	// rather than a query over the whole world. update() is skipped when
+	// nothing changed.
+	template <typename... Components>
+	class reactive_system : public system
+	{
+	private:
+		reactive<Components...>& m_changes;
+	protected:
+		reactive_system(registry& registry)
+			: system(registry), m_changes(registry.template create_reactive<Components...>()) {}
+
+		// Entities in ascending order, each once per update.
+		virtual void react(span<const entity> entities) = 0;
+	public:
+		void update() final
+		{
+			if (m_changes.pending() == 0)
+				return;
+			span<const entity> entities = m_changes.collect();
+			if (!entities.empty())
+				react(entities);
+		}
+	};
+}
+
+#endif // !APOLLO_REACTIVE_SYSTEM_H
@@ -3,64 +3,135 @@
 
 #include "core/type_traits.h"
 #include "archetype.h"
+#include "group.h"
+#include "index.h"
+#include "prefab.h"
+#include "reactive.h"
+#include "view.h"
 #include "system.h"
+#include "extract_system.h"
 #include "component.h"
 #include "observer.h"
+#include "world_view.h"
+#include "stats.h"
 #include "command/command_buffer.h"
 #include "job/job.h"
 #include "job/thread_pool.h"
+#include "snapshot/snapshot.h"
+#include "core/mapped_file.h"
+#include "memory/cold_store.h"
+#include "core/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <numeric>
 #include <vector>
 #include <unordered_map>
 #include <tuple>
 #include <memory>
-#include <sstream>
+#include <mutex>
+#include <string>
+#include <typeinfo>
 
 namespace apollo
 {
+	struct compact_policy
+	{
+		bool m_free_empty_archetypes = true;
+		bool m_trim_entity_index = true;
+		// storage is shrunk once less than this fraction of its capacity is used
+		float m_shrink_ratio = 0.5f;
+	};
+
+	// How registry::reduce combines partial results. fast keeps one accumulator per
+	// worker fed with chunks as they are claimed; deterministic folds fixed chunks and
+	// combines them in row order, so the result does not depend on the number of
+	// threads or on scheduling, floating point included.
+	enum class reduce_order
+	{
+		fast,
+		deterministic
+	};
+
 	class registry
 	{
 	private:
-		std::vector<std::unique_ptr<archetype>> m_archetypes;
+		std::pmr::memory_resource* m_resource;
+		// declared before m_archetypes, the group arenas must outlive the columns they back
+		std::vector<std::unique_ptr<group_base>> m_groups;
+		std::vector<archetype_ptr> m_archetypes;
 		std::vector<std::unique_ptr<system>> m_systems;
+		std::vector<std::unique_ptr<extract_system>> m_extract_systems;
+		std::size_t m_pipeline_depth = 1;
+		// extract stages still running, oldest first
+		std::deque<job_handle> m_pipeline;
 		std::vector<std::size_t> m_entity_index;
 		std::vector<entity> destroyed_entities;
+		std::vector<std::uint64_t> m_entity_ticks;
+		// entity index size before compact() last trimmed it, and the tick it did so at;
+		// deltas reaching back past the trim report the trimmed ids as destroyed
+		std::size_t m_trimmed_size = 0;
+		std::uint64_t m_trim_tick = 0;
+		std::uint64_t m_tick = 0;
+		std::shared_ptr<const world_view> m_world_view;
+		registry_counters m_counters;
+		std::vector<std::function<void(archetype&)>> m_order_rules;
+		std::vector<std::unique_ptr<index_base>> m_indexes;
+		std::vector<std::unique_ptr<reactive_base>> m_reactives;
 		std::unordered_map<id_type, observer> m_on_construct_observers;
 		std::unordered_map<id_type, observer> m_on_destroy_observers;
 		std::unordered_map<id_type, observer> m_on_update_observers;
+		std::mutex m_sync_mutex;
+		std::vector<std::function<void()>> m_sync_waiters;
+		cold_store m_cold_store;
 		thread_pool m_thread_pool;
 	private:
 		template <typename ClassType, typename ReturnType, typename Entity, typename... Args>
 		bool archetype_has_all_query_args_with_entity(archetype* archetype, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>)
 		{
-			return archetype->has_all<std::decay_t<Args>...>();
+			return !archetype->is_cold() && archetype->has_all<component_type_t<Args>...>();
+		}
+
+		// Like archetype_has_all_query_args_with_entity, but cold archetypes match too.
+		template <typename ClassType, typename ReturnType, typename Entity, typename... Args>
+		bool archetype_holds_query_args_with_entity(archetype* archetype, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>)
+		{
+			return archetype->has_all<component_type_t<Args>...>();
 		}
 
 		template <typename ClassType, typename ReturnType, typename... Args>
 		bool archetype_has_all_query_args_without_entity(archetype* archetype, function_traits<ReturnType(ClassType::*)(Args...)const>)
 		{
-			return archetype->has_all<std::decay_t<Args>...>();
+			return !archetype->is_cold() && archetype->has_all<component_type_t<Args>...>();
 		}
 
 		template<typename Fn, typename ClassType, typename ReturnType, typename Entity, typename... Args>
-		void apply_to_archetype_components(archetype* archetype, Fn&& func, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>)
+		void apply_to_archetype_components(archetype* archetype, Fn&& func, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>, const std::uint64_t tick)
 		{
-			std::tuple<std::vector<std::decay_t<Args>>&...> components{ *archetype->get_components<std::decay_t<Args>>()... };
-			auto size = std::get<0>(components).size();
+			auto components = std::make_tuple(archetype->get_column<component_type_t<Args>>()...);
+			auto size = archetype->m_entities.size();
 			for (std::size_t i = 0; i < size; ++i)
 			{
-				std::apply([&](auto&... vecs) {
-					func(archetype->m_entities[i], vecs[i]...);
+				std::apply([&](auto... columns) {
+					func(archetype->m_entities[i], archetype->column_at(columns, i)...);
 					}, components);
 			}
+			if constexpr (((!std::is_const<std::remove_reference_t<Args>>::value) || ...))
+				std::fill(archetype->m_versions.begin(), archetype->m_versions.end(), tick);
+		}
+
+		template<typename Fn, typename ClassType, typename ReturnType, typename Entities, typename... Args>
+		void apply_to_archetype_chunk(archetype* archetype, Fn&& func, function_traits<ReturnType(ClassType::*)(Entities, Args...)const>, const std::size_t begin, const std::size_t count, const std::uint64_t tick)
+		{
+			func(span<const entity>(archetype->m_entities.data() + begin, count), archetype->get_column_span<std::decay_t<Args>>(begin, count)...);
+			if constexpr (((!std::is_const<typename std::decay_t<Args>::element_type>::value) || ...))
+				std::fill(archetype->m_versions.begin() + begin, archetype->m_versions.begin() + begin + count, tick);
 		}
 
 		template<typename Fn, typename ClassType, typename ReturnType, typename... Args>
-		void apply_to_archetype_entity_components(archetype* archetype, Fn&& func, function_traits<ReturnType(ClassType::*)(Args...)const>, const entity& entity)
+		void apply_to_archetype_entity_components(archetype* archetype, Fn&& func, function_traits<ReturnType(ClassType::*)(Args...)const>, const std::size_t index)
 		{
-			auto components = archetype->get_components<std::decay_t<Args>...>(entity);
-			std::apply([&](auto&... component) {
-				func(component...);
-				}, components);
+			func(archetype->get_component_at<component_type_t<Args>>(index)...);
 		}
 
 		template<typename Component>
@@ -68,13 +139,673 @@ namespace apollo
 		{
 			auto it = m_on_update_observers.find(Component::id);
 			if (it != m_on_update_observers.end())
+			{
+				m_counters.m_observer_notifications.increment();
 				it->second.notify(*this, entity);
+			}
 		}
 
 		template<typename ClassType, typename ReturnType, typename... Args>
 		void apply_to_on_update_observers(const entity& entity, function_traits<ReturnType(ClassType::*)(Args...)const>)
 		{
-			((apply_to_on_update_observers<std::decay_t<Args>>(entity)), ...);
+			((apply_to_on_update_observers<component_type_t<Args>>(entity)), ...);
+		}
+
+		void apply_archetype_rules(archetype& archetype)
+		{
+			for (auto& rule : m_order_rules)
+				rule(archetype);
+			for (auto& group : m_groups)
+				group->try_adopt(archetype);
+		}
+
+		void maintain_groups()
+		{
+			for (auto& group : m_groups)
+				group->maintain();
+		}
+
+		void refresh_groups()
+		{
+			for (auto& group : m_groups)
+			{
+				group->clear_members();
+				for (auto& archetype : m_archetypes)
+					group->try_adopt(*archetype);
+				group->maintain();
+			}
+		}
+
+		// load and apply_delta write rows without notifying observers
+		void rebuild_indexes()
+		{
+			for (auto& index : m_indexes)
+				index->rebuild(m_archetypes);
+		}
+
+		void add_order_rule(std::function<void(archetype&)> rule)
+		{
+			for (auto& archetype : m_archetypes)
+				rule(*resident(archetype.get()));
+			m_order_rules.push_back(std::move(rule));
+		}
+
+		template <typename Archetypes, typename Fn>
+		job query_archetypes(const Archetypes& archetypes, Fn&& fn, job& dep)
+		{
+			typedef function_traits<decltype(fn)> traits;
+			typename traits::self t;
+			static_assert(std::is_same<std::remove_cv_t<std::remove_reference_t<typename traits::template arg<0>>>, entity>::value, "first type parameter of query must be of type apollo::entity");
+			std::vector<std::function<void()>> queries;
+			for (auto& a : archetypes)
+			{
+				archetype* archetype = &*a;
+				if (archetype_has_all_query_args_with_entity(archetype, t))
+				{
+					m_counters.m_query_matches.increment();
+					archetype->merge_sorted_tail();
+					queries.emplace_back([this, archetype, fn, t, tick = m_tick]() {
+						APOLLO_TRACE_SCOPE("query_chunk", "query");
+						this->apply_to_archetype_components(archetype, fn, t, tick);
+						});
+				}
+			}
+			return job(&m_thread_pool, [pool = &m_thread_pool, dep = std::move(dep), queries = std::move(queries)]() {
+				if (dep.m_handle.valid())
+					dep.m_handle.complete();
+				for (auto& query : queries)
+				{
+					pool->preempt();
+					query();
+				}
+			});
+		}
+
+		template <typename Archetypes, typename Fn>
+		job query_archetype_chunks(const Archetypes& archetypes, Fn&& fn, job& dep, const std::size_t chunk_size)
+		{
+			typedef function_traits<decltype(fn)> traits;
+			typename traits::self t;
+			static_assert(std::is_same<std::decay_t<typename traits::template arg<0>>, span<const entity>>::value, "first type parameter of chunk query must be of type apollo::span<const apollo::entity>");
+			std::vector<std::function<void()>> queries;
+			for (auto& a : archetypes)
+			{
+				archetype* archetype = &*a;
+				if (archetype_has_all_query_args_with_entity(archetype, t))
+				{
+					m_counters.m_query_matches.increment();
+					archetype->merge_sorted_tail();
+					queries.emplace_back([this, archetype, fn, t, chunk_size, tick = m_tick]() {
+						APOLLO_TRACE_SCOPE("query_chunk", "query");
+						const std::size_t size = archetype->m_entities.size();
+						const std::size_t step = chunk_size ? chunk_size : size;
+						for (std::size_t begin = 0; begin < size; begin += step)
+						{
+							this->m_thread_pool.preempt();
+							this->apply_to_archetype_chunk(archetype, fn, t, begin, std::min(step, size - begin), tick);
+						}
+						});
+				}
+			}
+			return job(&m_thread_pool, [pool = &m_thread_pool, dep = std::move(dep), queries = std::move(queries)]() {
+				if (dep.m_handle.valid())
+					dep.m_handle.complete();
+				for (auto& query : queries)
+				{
+					pool->preempt();
+					query();
+				}
+			});
+		}
+
+		struct reduce_chunk
+		{
+			archetype* m_archetype;
+			std::size_t m_begin;
+			std::size_t m_count;
+		};
+
+		template <typename... Components, typename Fn>
+		static void for_each_row(const reduce_chunk& chunk, Fn&& fn)
+		{
+			archetype* archetype = chunk.m_archetype;
+			auto columns = std::make_tuple(archetype->get_column<Components>()...);
+			for (std::size_t i = chunk.m_begin; i < chunk.m_begin + chunk.m_count; ++i)
+			{
+				std::apply([&](auto... columns) {
+					fn(archetype->m_entities[i], archetype->column_at(columns, i)...);
+				}, columns);
+			}
+		}
+
+		// Runs fn(index) for every index below count on the pool and the calling thread,
+		// and returns once all have run.
+		template <typename Fn>
+		void parallel_indices(const std::size_t count, Fn&& fn)
+		{
+			std::atomic<std::size_t> next{ 0 };
+			auto worker = [this, &next, &fn, count]() {
+				for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed))
+				{
+					m_thread_pool.preempt();
+					fn(i);
+				}
+			};
+			const std::size_t helpers = std::min(count, m_thread_pool.size() + 1) - 1;
+			std::vector<job_handle> handles;
+			handles.reserve(helpers);
+			for (std::size_t i = 0; i < helpers; ++i)
+				handles.push_back(job(&m_thread_pool, worker).schedule());
+			worker();
+			for (auto& handle : handles)
+				handle.complete();
+		}
+
+		// Splits the matching archetypes into chunks, folds them into partials seeded with
+		// identity and merges the partials pairwise, level by level.
+		template <typename T, typename Matches, typename Fold, typename Merge>
+		T reduce_chunks(const T& identity, Matches&& matches, Fold&& fold, Merge&& merge, const reduce_order order, const std::size_t chunk_size)
+		{
+			APOLLO_TRACE_SCOPE("registry::reduce", "query");
+			const std::size_t step = chunk_size ? chunk_size : 1;
+			std::vector<reduce_chunk> chunks;
+			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
+			{
+				archetype* archetype = m_archetypes[i].get();
+				if (archetype->is_cold() || !matches(archetype) || archetype->m_entities.empty())
+					continue;
+				m_counters.m_query_matches.increment();
+				archetype->merge_sorted_tail();
+				const std::size_t size = archetype->m_entities.size();
+				for (std::size_t begin = 0; begin < size; begin += step)
+					chunks.push_back({ archetype, begin, std::min(step, size - begin) });
+			}
+			if (chunks.empty())
+				return identity;
+
+			std::vector<T> partials;
+			if (order == reduce_order::deterministic)
+			{
+				partials.assign(chunks.size(), identity);
+				parallel_indices(chunks.size(), [&](const std::size_t c) {
+					fold(partials[c], chunks[c]);
+				});
+			}
+			else
+			{
+				partials.assign(std::min(chunks.size(), m_thread_pool.size() + 1), identity);
+				std::atomic<std::size_t> next{ 0 };
+				parallel_indices(partials.size(), [&](const std::size_t w) {
+					for (std::size_t c = next.fetch_add(1, std::memory_order_relaxed); c < chunks.size(); c = next.fetch_add(1, std::memory_order_relaxed))
+						fold(partials[w], chunks[c]);
+				});
+			}
+			for (std::size_t stride = 1; stride < partials.size(); stride *= 2)
+			{
+				parallel_indices((partials.size() - stride + 2 * stride - 1) / (2 * stride), [&](const std::size_t pair) {
+					merge(partials[pair * 2 * stride], partials[pair * 2 * stride + stride]);
+				});
+			}
+			return std::move(partials.front());
+		}
+
+		template<typename T, typename Fn, typename Combine, typename ClassType, typename ReturnType, typename Accumulator, typename Entity, typename... Args>
+		T reduce_query(const T& identity, Fn& fn, Combine& combine, const reduce_order order, const std::size_t chunk_size, function_traits<ReturnType(ClassType::*)(Accumulator, Entity, Args...)const>)
+		{
+			static_assert(std::is_same<Accumulator, T&>::value, "first parameter of a reduction must be a reference to the accumulated type");
+			return reduce_chunks(identity, [](archetype* archetype) {
+				return archetype->has_all<component_type_t<Args>...>();
+			}, [&fn](T& accumulator, const reduce_chunk& chunk) {
+				for_each_row<component_type_t<Args>...>(chunk, [&](const entity& e, auto&&... components) {
+					fn(accumulator, e, components...);
+				});
+			}, combine, order, chunk_size);
+		}
+
+		template<typename T, typename Transform, typename Combine, typename ClassType, typename ReturnType, typename Entity, typename... Args>
+		T transform_reduce_query(const T& identity, Transform& transform, Combine& combine, const reduce_order order, const std::size_t chunk_size, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>)
+		{
+			return reduce_chunks(identity, [](archetype* archetype) {
+				return archetype->has_all<component_type_t<Args>...>();
+			}, [&transform, &combine](T& accumulator, const reduce_chunk& chunk) {
+				for_each_row<component_type_t<Args>...>(chunk, [&](const entity& e, auto&&... components) {
+					accumulator = combine(accumulator, transform(e, components...));
+				});
+			}, [&combine](T& accumulator, const T& other) {
+				accumulator = combine(accumulator, other);
+			}, order, chunk_size);
+		}
+
+		template<typename Fn, typename ClassType, typename ReturnType, typename Entity, typename... Args>
+		void select_rows(archetype* archetype, Fn& pred, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>, std::vector<std::size_t>& rows, std::vector<std::size_t>& rest)
+		{
+			rows.clear();
+			rest.clear();
+			auto columns = std::make_tuple(archetype->get_column<component_type_t<Args>>()...);
+			for (std::size_t i = 0; i < archetype->m_entities.size(); ++i)
+			{
+				const bool selected = std::apply([&](auto... columns) {
+					return static_cast<bool>(pred(archetype->m_entities[i], archetype->column_at(columns, i)...));
+				}, columns);
+				(selected ? rows : rest).push_back(i);
+			}
+		}
+
+		template <typename TComponent>
+		archetype* archetype_without(archetype* context)
+		{
+			return archetype_without(context, TComponent::id);
+		}
+
+		archetype* archetype_without(archetype* context, const id_type component_id)
+		{
+			archetype* new_archetype = context->get_edge(component_id);
+			if (new_archetype)
+				return resident(new_archetype);
+			archetype temp{ 0 };
+			temp.m_signature = context->m_signature;
+			temp.remove_from_signature(component_id);
+
+			archetype* existing_archetype = find_archetype_with_same_signature(temp);
+			if (!existing_archetype)
+			{
+				new_archetype = context->with_removed_component(component_id, m_archetypes.size());
+				m_archetypes.emplace_back(new_archetype);
+				apply_archetype_rules(*new_archetype);
+				return new_archetype;
+			}
+			context->set_edge(component_id, existing_archetype);
+			existing_archetype->set_edge(component_id, context);
+			return resident(existing_archetype);
+		}
+
+		// Structural commands gathered for one batched playback.
+		struct playback_plan
+		{
+			struct move
+			{
+				entity m_entity;
+				archetype* m_source;
+				// nullptr when the entity is destroyed
+				archetype* m_target;
+			};
+
+			struct event
+			{
+				entity m_entity;
+				// removed component, or invalid_index when archetype's components were destroyed
+				id_type m_component;
+				archetype* m_archetype;
+			};
+
+			// one per source archetype, rows ascending, applied as a unit
+			struct group
+			{
+				archetype* m_source;
+				std::vector<std::size_t> m_rows;
+				std::vector<archetype*> m_targets;
+				std::vector<std::pair<archetype*, std::vector<std::size_t>>> m_moves;
+			};
+
+			std::vector<move> m_moves;
+			std::unordered_map<entity, std::size_t> m_move_index;
+			std::vector<event> m_events;
+		};
+
+		void plan_change(playback_plan& plan, const entity e, const id_type component)
+		{
+			if (e >= m_entity_index.size() || m_entity_index[e] == invalid_index)
+				return;
+			auto it = plan.m_move_index.find(e);
+			if (it == plan.m_move_index.end())
+			{
+				archetype* source = resident(m_archetypes[m_entity_index[e]].get());
+				it = plan.m_move_index.emplace(e, plan.m_moves.size()).first;
+				plan.m_moves.push_back({ e, source, source });
+			}
+			auto& move = plan.m_moves[it->second];
+			if (!move.m_target)
+				return;
+			if (component == invalid_index)
+			{
+				plan.m_events.push_back({ e, invalid_index, move.m_target });
+				move.m_target = nullptr;
+			}
+			else if (move.m_target->get_id() != 0 && component < move.m_target->m_signature.size() && move.m_target->m_signature[component] != invalid_index)
+			{
+				plan.m_events.push_back({ e, component, nullptr });
+				move.m_target = archetype_without(move.m_target, component);
+			}
+		}
+
+		static void apply_group(playback_plan::group& group, const std::uint64_t tick)
+		{
+			archetype* source = group.m_source;
+			for (auto& move : group.m_moves)
+			{
+				if (move.first)
+					move.first->append(*source, move.second, tick);
+			}
+			std::vector<std::size_t> rest;
+			rest.reserve(source->m_entities.size() - group.m_rows.size());
+			auto moved = group.m_rows.begin();
+			for (std::size_t row = 0; row < source->m_entities.size(); ++row)
+			{
+				if (moved != group.m_rows.end() && *moved == row)
+					++moved;
+				else
+					rest.push_back(row);
+			}
+			if (rest.empty())
+				source->clear();
+			else
+				source->retain(rest);
+		}
+
+		void apply_plan(playback_plan& plan)
+		{
+			if (plan.m_moves.empty())
+				return;
+			// group the moving rows by source archetype, one scan of each source
+			std::unordered_map<archetype*, std::size_t> group_index;
+			std::vector<playback_plan::group> groups;
+			for (const auto& move : plan.m_moves)
+			{
+				if (move.m_target == move.m_source || move.m_source->get_id() == 0)
+					continue;
+				if (group_index.emplace(move.m_source, groups.size()).second)
+					groups.push_back({ move.m_source, {}, {}, {} });
+			}
+			std::unordered_map<archetype*, std::size_t> growth;
+			for (auto& group : groups)
+			{
+				archetype* source = group.m_source;
+				std::unordered_map<archetype*, std::size_t> target_index;
+				for (std::size_t row = 0; row < source->m_entities.size(); ++row)
+				{
+					auto it = plan.m_move_index.find(source->m_entities[row]);
+					if (it == plan.m_move_index.end())
+						continue;
+					const auto& move = plan.m_moves[it->second];
+					if (move.m_target == source)
+						continue;
+					group.m_rows.push_back(row);
+					auto target = target_index.emplace(move.m_target, group.m_moves.size());
+					if (target.second)
+					{
+						group.m_moves.push_back({ move.m_target, {} });
+						if (move.m_target)
+							group.m_targets.push_back(move.m_target);
+					}
+					group.m_moves[target.first->second].second.push_back(row);
+					if (move.m_target)
+						++growth[move.m_target];
+				}
+			}
+			// the pool must not allocate from m_resource, targets grow here
+			for (const auto& target : growth)
+				target.first->reserve(target.first->m_entities.size() + target.second);
+
+			// groups touching disjoint archetypes share a wave and run in parallel
+			std::vector<std::vector<std::size_t>> waves;
+			std::vector<std::vector<archetype*>> wave_archetypes;
+			for (std::size_t g = 0; g < groups.size(); ++g)
+			{
+				auto touches = [&groups, g](const std::vector<archetype*>& used) {
+					auto uses = [&used](archetype* a) {
+						return std::find(used.begin(), used.end(), a) != used.end();
+					};
+					return uses(groups[g].m_source) || std::any_of(groups[g].m_targets.begin(), groups[g].m_targets.end(), uses);
+				};
+				std::size_t wave = 0;
+				while (wave < waves.size() && touches(wave_archetypes[wave]))
+					++wave;
+				if (wave == waves.size())
+				{
+					waves.emplace_back();
+					wave_archetypes.emplace_back();
+				}
+				waves[wave].push_back(g);
+				wave_archetypes[wave].push_back(groups[g].m_source);
+				wave_archetypes[wave].insert(wave_archetypes[wave].end(), groups[g].m_targets.begin(), groups[g].m_targets.end());
+			}
+			std::vector<job_handle> handles;
+			for (const auto& wave : waves)
+			{
+				handles.clear();
+				for (std::size_t i = 1; i < wave.size(); ++i)
+				{
+					playback_plan::group* group = &groups[wave[i]];
+					job apply(&m_thread_pool, [group, tick = m_tick]() {
+						apply_group(*group, tick);
+					});
+					handles.push_back(apply.schedule());
+				}
+				apply_group(groups[wave.front()], m_tick);
+				for (auto& handle : handles)
+					handle.complete();
+			}
+
+			std::vector<archetype*> touched;
+			for (const auto& move : plan.m_moves)
+			{
+				if (move.m_target == move.m_source)
+					continue;
+				if (move.m_target)
+				{
+					m_entity_index[move.m_entity] = move.m_target->get_id();
+					touched.push_back(move.m_target);
+				}
+				else
+				{
+					m_entity_index[move.m_entity] = invalid_index;
+					destroyed_entities.push_back(move.m_entity);
+				}
+				m_entity_ticks[move.m_entity] = m_tick;
+				m_counters.m_archetype_moves.increment();
+			}
+			std::sort(touched.begin(), touched.end());
+			touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+			for (archetype* target : touched)
+				target->maintain_order();
+			maintain_groups();
+
+			for (const auto& event : plan.m_events)
+			{
+				if (event.m_component != invalid_index)
+				{
+					auto it = m_on_destroy_observers.find(event.m_component);
+					if (it != m_on_destroy_observers.end())
+					{
+						m_counters.m_observer_notifications.increment();
+						it->second.notify(*this, event.m_entity);
+					}
+					continue;
+				}
+				for (std::size_t i = 0; i < event.m_archetype->m_signature.size(); ++i)
+				{
+					if (event.m_archetype->m_signature[i] == invalid_index)
+						continue;
+					auto it = m_on_destroy_observers.find(i);
+					if (it != m_on_destroy_observers.end())
+					{
+						m_counters.m_observer_notifications.increment();
+						it->second.notify(*this, event.m_entity);
+					}
+				}
+			}
+			plan = playback_plan();
+		}
+
+		// Pages a cold archetype back in before it is read or changed.
+		inline archetype* resident(archetype* archetype)
+		{
+			if (archetype->is_cold())
+				page_in(*archetype);
+			return archetype;
+		}
+
+		bool page_out(archetype& archetype)
+		{
+			if (archetype.is_cold() || archetype.get_id() == 0 || archetype.m_entities.empty() || archetype.get_group() || !archetype.pageable())
+				return false;
+			archetype.merge_sorted_tail();
+			const std::size_t page = m_cold_store.write(archetype.page_bytes(), [&archetype](std::byte* destination) {
+				archetype.page_out(destination);
+			});
+			if (page == invalid_index)
+				return false;
+			archetype.set_page(page);
+			return true;
+		}
+
+		void page_in(archetype& archetype)
+		{
+			const std::size_t page = archetype.get_page();
+			archetype.page_in(m_cold_store.data(page));
+			m_cold_store.release(page, archetype.page_bytes());
+		}
+
+		// Frees the page of a cold archetype whose rows are about to be dropped.
+		void discard_page(archetype& archetype)
+		{
+			if (!archetype.is_cold())
+				return;
+			m_cold_store.release(archetype.get_page(), archetype.page_bytes());
+			archetype.set_page(invalid_index);
+		}
+
+		// Column bytes of storage index, read from the cold store when the archetype is cold.
+		const void* column_data(const archetype& archetype, const std::size_t index) const
+		{
+			if (archetype.is_cold())
+				return m_cold_store.data(archetype.get_page() + archetype.page_offset(index));
+			return archetype.m_storages[index]->data();
+		}
+
+		// Archetype holding exactly TComponents, created when missing.
+		template <typename... TComponents>
+		archetype* archetype_with()
+		{
+			archetype temp{ 0 };
+			std::size_t index = 0;
+			((temp.add_to_signature(index++, TComponents::id)), ...);
+			if (archetype* existing = find_archetype_with_same_signature(temp))
+				return resident(existing);
+			storage_vec storages;
+			((storages.push_back(std::make_unique<component_storage_impl<TComponents>>(m_resource))), ...);
+			archetype* created = archetype::make(m_resource, m_archetypes.size(), storages);
+			m_archetypes.emplace_back(created);
+			apply_archetype_rules(*created);
+			return created;
+		}
+
+		// Creates count entities in target after fill has grown each of its columns by count.
+		template <typename Fill>
+		void spawn(archetype* target, const std::size_t count, std::vector<entity>& instances, Fill&& fill)
+		{
+			instances.clear();
+			instances.reserve(count);
+			for (std::size_t i = 0; i < count; ++i)
+				instances.push_back(create());
+			if (target->get_id() == 0)
+				return;
+			fill();
+			target->m_entities.insert(target->m_entities.end(), instances.begin(), instances.end());
+			target->m_versions.resize(target->m_entities.size(), m_tick);
+			for (entity e : instances)
+				m_entity_index[e] = target->get_id();
+			target->maintain_order();
+			maintain_groups();
+			for (std::size_t i = 0; i < target->m_signature.size(); ++i)
+			{
+				if (target->m_signature[i] != invalid_index)
+					notify_batch(m_on_construct_observers, i, instances);
+			}
+		}
+
+		// Moves rows of context (rest are the rows staying) to the archetype without TComponent.
+		template <typename TComponent>
+		std::size_t remove_rows(archetype* context, const std::vector<std::size_t>& rows, const std::vector<std::size_t>& rest)
+		{
+			archetype* target = archetype_without<TComponent>(context);
+			const std::size_t first = target->m_entities.size();
+			target->append(*context, rows, m_tick);
+			if (rest.empty())
+				context->clear();
+			else
+				context->retain(rest);
+			std::vector<entity> entities(target->m_entities.begin() + first, target->m_entities.end());
+			for (entity e : entities)
+			{
+				m_entity_index[e] = target->get_id();
+				m_entity_ticks[e] = m_tick;
+			}
+			target->maintain_order();
+			m_counters.m_archetype_moves.increment(entities.size());
+			notify_batch(m_on_destroy_observers, TComponent::id, entities);
+			return entities.size();
+		}
+
+		// Frees entities whose rows were already dropped from context and notifies the
+		// destroy observers of each of its components once.
+		void release_entities(archetype& context, const std::vector<entity>& entities)
+		{
+			for (entity e : entities)
+			{
+				m_entity_index[e] = invalid_index;
+				m_entity_ticks[e] = m_tick;
+				destroyed_entities.push_back(e);
+			}
+			for (std::size_t i = 0; i < context.m_signature.size(); ++i)
+			{
+				if (context.m_signature[i] != invalid_index)
+					notify_batch(m_on_destroy_observers, i, entities);
+			}
+		}
+
+		void notify_batch(std::unordered_map<id_type, observer>& observers, const id_type id, const std::vector<entity>& entities)
+		{
+			auto it = observers.find(id);
+			if (it != observers.end())
+			{
+				m_counters.m_observer_notifications.increment();
+				it->second.notify_batch(*this, span<const entity>(entities.data(), entities.size()));
+			}
+		}
+
+		// Stage boundary: the frame's jobs finish, its view is published and the
+		// extract systems run on it, chained after the previous frame's stage.
+		void extract()
+		{
+			for (auto& system : m_systems)
+				system->complete();
+			std::shared_ptr<const world_view> view = publish_world_view();
+			if (m_pipeline_depth == 1)
+			{
+				for (auto& system : m_extract_systems)
+				{
+					APOLLO_TRACE_SCOPE(trace_type_name(typeid(*system)), "system");
+					system->update(*view);
+				}
+				return;
+			}
+			while (m_pipeline.size() >= m_pipeline_depth - 1)
+			{
+				m_pipeline.front().complete();
+				m_pipeline.pop_front();
+			}
+			job_handle previous = m_pipeline.empty() ? job_handle() : m_pipeline.back();
+			job stage(&m_thread_pool, [this, view, previous]() {
+				if (previous.valid())
+					previous.complete();
+				for (auto& system : m_extract_systems)
+				{
+					APOLLO_TRACE_SCOPE(trace_type_name(typeid(*system)), "system");
+					system->update(*view);
+				}
+			});
+			m_pipeline.push_back(stage.schedule());
 		}
 
 		archetype* find_archetype_with_same_signature(archetype& archetpye)
@@ -88,12 +819,28 @@ namespace apollo
 		}
 	public:
 		registry()
-			: m_thread_pool(std::thread::hardware_concurrency())
+			: registry(std::thread::hardware_concurrency())
+		{
+		}
+
+		explicit registry(const std::size_t num_threads, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_resource(resource), m_thread_pool(num_threads)
 		{
-			auto empty_archetype = new archetype(m_archetypes.size());
+			auto empty_archetype = archetype::make(m_resource, m_archetypes.size());
 			m_archetypes.emplace_back(empty_archetype);
 		}
 
+		// Extract stages in flight reference the registry, and the pool drops queued
+		// tasks when it stops, so they are drained before anything is torn down.
+		// Systems finish next, while the pool and sync point they may wait on are alive.
+		~registry()
+		{
+			flush_pipeline();
+			for (auto& system : m_systems)
+				system->finish();
+			m_systems.clear();
+		}
+
 		template <typename Component>
 		observer& on_construct()
 		{
@@ -115,36 +862,117 @@ namespace apollo
 		template <typename Component>
 		observer& on_update()
 		{
-			auto it = m_on_destroy_observers.find(Component::id);
-			if (it == m_on_destroy_observers.end())
-				m_on_destroy_observers[Component::id] = observer();
-			return m_on_destroy_observers[Component::id];
+			auto it = m_on_update_observers.find(Component::id);
+			if (it == m_on_update_observers.end())
+				m_on_update_observers[Component::id] = observer();
+			return m_on_update_observers[Component::id];
+		}
+
+		// Returns the registry's index of type Index (hash_index<&T::m_field> or
+		// ordered_index<&T::m_field>), creating and filling it on first use.
+		template <typename Index>
+		Index& index()
+		{
+			using Component = typename Index::component_type;
+			for (auto& i : m_indexes)
+			{
+				if (auto existing = dynamic_cast<Index*>(i.get()))
+					return *existing;
+			}
+			for (auto& archetype : m_archetypes)
+			{
+				if (archetype->is_cold() && archetype->has_all<Component>())
+					page_in(*archetype);
+			}
+			m_indexes.push_back(std::make_unique<Index>());
+			Index* index = static_cast<Index*>(m_indexes.back().get());
+			index->rebuild(m_archetypes);
+			// Bulk paths notify runs of consecutive rows, so each entity is first looked for
+			// right after the previous one and only searched for, from the back where new
+			// rows land, when that misses.
+			auto insert = [index](registry& r, span<const entity> entities) {
+				archetype* context = nullptr;
+				std::size_t row = 0;
+				for (entity e : entities)
+				{
+					if (!r.valid(e) || !r.m_entity_index[e])
+						continue;
+					archetype* current = r.resident(r.m_archetypes[r.m_entity_index[e]].get());
+					const auto& rows = current->get_entities();
+					if (current != context || ++row >= rows.size() || rows[row] != e)
+					{
+						auto it = std::find(rows.rbegin(), rows.rend(), e);
+						if (it == rows.rend())
+							continue;
+						context = current;
+						row = std::distance(it, rows.rend()) - 1;
+					}
+					index->insert_row(*current, row);
+				}
+			};
+			on_construct<Component>().connect_batch(insert);
+			on_update<Component>().connect_batch(insert);
+			on_destroy<Component>().connect_batch([index](registry&, span<const entity> entities) {
+				for (entity e : entities)
+					index->erase(e);
+			});
+			return *index;
+		}
+
+		// Returns a new change set of the entities holding all of TComponents: constructing
+		// or updating one of them marks the entity, removing one or destroying the entity
+		// unmarks it. Owned by the registry, every consumer should create its own.
+		template <typename... TComponents>
+		reactive<TComponents...>& create_reactive()
+		{
+			static_assert((std::is_base_of<component<TComponents>, TComponents>::value && ...), "type parameter of this class must derive from component");
+			auto* result = new reactive<TComponents...>();
+			m_reactives.emplace_back(result);
+			result->set_filter([this](const entity e) {
+				return valid(e) && m_archetypes[m_entity_index[e]]->template has_all<TComponents...>();
+			});
+			reactive_base* changes = result;
+			auto mark = [changes](registry&, span<const entity> entities) {
+				for (entity e : entities)
+					changes->mark(e);
+			};
+			auto unmark = [changes](registry&, span<const entity> entities) {
+				for (entity e : entities)
+					changes->unmark(e);
+			};
+			(on_construct<TComponents>().connect_batch(mark), ...);
+			(on_update<TComponents>().connect_batch(mark), ...);
+			(on_destroy<TComponents>().connect_batch(unmark), ...);
+			return *result;
 		}
 
 		const entity create()
 		{
-			static entity s_current_id = 0;
 			entity current;
 			if (destroyed_entities.size())
 			{
 				current = destroyed_entities.back();
 				destroyed_entities.pop_back();
 				m_entity_index[current] = 0;
+				m_counters.m_entity_recycles.increment();
+				m_entity_ticks[current] = m_tick;
 			}
 			else
 			{
-				current = s_current_id++;
+				current = m_entity_index.size();
 				m_entity_index.push_back(0);
+				m_entity_ticks.push_back(m_tick);
 			}
 			return current;
 		}
 
 		void destroy(entity& entity)
 		{
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 
 			context->remove(entity);
 			m_entity_index[entity] = invalid_index;
+			m_entity_ticks[entity] = m_tick;
 			destroyed_entities.push_back(entity);
 
 			for (std::size_t i = 0; i < context->m_signature.size(); ++i)
@@ -153,67 +981,297 @@ namespace apollo
 				{
 					auto it = m_on_destroy_observers.find(i);
 					if (it != m_on_destroy_observers.end())
+					{
+						m_counters.m_observer_notifications.increment();
 						it->second.notify(*this, entity);
+					}
 				}
 			}
 		}
 
-		bool valid(const entity& entity)
+		bool valid(const entity& entity) const
 		{
-			return m_entity_index[entity] == invalid_index;
+			return entity < m_entity_index.size() && m_entity_index[entity] != invalid_index;
 		}
 
 		void update()
 		{
+			run_sync_point();
 			for (auto& system : m_systems)
 			{
+				APOLLO_TRACE_SCOPE(trace_type_name(typeid(*system)), "system");
 				system->update();
 			}
+			if (!m_extract_systems.empty())
+				extract();
+			++m_tick;
+		}
+
+		// Number of frames whose stages may run at once. At 1 the extract
+		// systems finish inside update(); above that update() returns once the
+		// frame is published and at most depth - 1 extract stages are in flight.
+		void set_pipeline_depth(const std::size_t depth)
+		{
+			m_pipeline_depth = std::max<std::size_t>(depth, 1);
+			while (m_pipeline.size() > m_pipeline_depth - 1)
+			{
+				m_pipeline.front().complete();
+				m_pipeline.pop_front();
+			}
+		}
+
+		inline std::size_t pipeline_depth() const
+		{
+			return m_pipeline_depth;
+		}
+
+		// Waits for every extract stage in flight.
+		void flush_pipeline()
+		{
+			for (auto& handle : m_pipeline)
+				handle.complete();
+			m_pipeline.clear();
+		}
+
+		// Runs fn on the thread calling update(), at the start of the next update
+		// before any system. Safe to call from jobs.
+		void at_sync_point(std::function<void()> fn)
+		{
+			std::lock_guard<std::mutex> lock(m_sync_mutex);
+			m_sync_waiters.push_back(std::move(fn));
+		}
+
+		// Runs the functions queued through at_sync_point so far, as update() does first.
+		// Returns whether any ran.
+		bool run_sync_point()
+		{
+			std::vector<std::function<void()>> waiters;
+			{
+				std::lock_guard<std::mutex> lock(m_sync_mutex);
+				waiters.swap(m_sync_waiters);
+			}
+			for (auto& waiter : waiters)
+				waiter();
+			return !waiters.empty();
+		}
+
+		inline std::uint64_t tick() const
+		{
+			return m_tick;
 		}
 
 		template <typename Fn>
 		job for_each(Fn&& fn, job& dep)
 		{
-			typedef function_traits<decltype(fn)> traits;
-			auto t = traits::self();
-			static_assert(std::is_same<std::remove_cv_t<std::remove_reference_t<traits::arg<0>>>, entity>::value, "first type parameter of query must be of type apollo::entity");
-			std::vector<std::function<void()>> queries;
+			return query_archetypes(m_archetypes, std::forward<Fn>(fn), dep);
+		}
+
+		template <typename... Owned, typename Fn>
+		job for_each(const apollo::group<Owned...>& group, Fn&& fn, job& dep)
+		{
+			return query_archetypes(group.get_members(), std::forward<Fn>(fn), dep);
+		}
+
+		// Calls fn(span<const entity>, span<T>..., soa_span<U>...) once per matching archetype,
+		// or once per chunk_size rows of it when chunk_size is non-zero.
+		template <typename Fn>
+		job for_each_chunk(Fn&& fn, job& dep, const std::size_t chunk_size = 0)
+		{
+			return query_archetype_chunks(m_archetypes, std::forward<Fn>(fn), dep, chunk_size);
+		}
+
+		template <typename... Owned, typename Fn>
+		job for_each_chunk(const apollo::group<Owned...>& group, Fn&& fn, job& dep, const std::size_t chunk_size = 0)
+		{
+			return query_archetype_chunks(group.get_members(), std::forward<Fn>(fn), dep, chunk_size);
+		}
+
+		// Owning group: the Owned columns of all archetypes holding them are packed into one
+		// arena per component, and queries through the group skip archetype matching.
+		template <typename... Owned>
+		apollo::group<Owned...>& group()
+		{
+			static_assert(((std::is_base_of<component<Owned>, Owned>::value) && ...), "type parameters Owned must derive from component");
+			for (auto& g : m_groups)
+			{
+				if (auto existing = dynamic_cast<apollo::group<Owned...>*>(g.get()))
+					return *existing;
+			}
+			auto g = std::make_unique<apollo::group<Owned...>>(m_resource);
 			for (auto& archetype : m_archetypes)
 			{
-				if (archetype_has_all_query_args_with_entity(archetype.get(), t))
-				{
-					queries.emplace_back([this, &archetype, &fn, &t]() {
-						this->apply_to_archetype_components(archetype.get(), fn, t);
-						});
-				}
+				if (archetype->is_cold() && archetype->has_all<Owned...>())
+					page_in(*archetype);
+				g->try_adopt(*archetype);
 			}
-			return job(&m_thread_pool, [dep = std::move(dep), queries = std::move(queries)]() {
-				std::stringstream s;
-				s << "dep[" << dep.m_id << "] - ";
-				if (dep.m_handle.valid())
-				{
-					s << " valid\n";
-					//std::cout << s.str();
-					dep.m_handle.complete();
-				}
-				else
+			g->maintain();
+			m_groups.push_back(std::move(g));
+			return static_cast<apollo::group<Owned...>&>(*m_groups.back());
+		}
+
+		template <typename TSystem, typename... Args>
+		const TSystem& create_extract_system(Args&&... args)
+		{
+			static_assert(std::is_base_of<extract_system, TSystem>::value, "type parameter of this class must derive from extract_system");
+			flush_pipeline();
+			m_extract_systems.push_back(std::make_unique<TSystem>(std::forward<Args>(args)...));
+			return *dynamic_cast<TSystem*>(m_extract_systems.back().get());
+		}
+
+		template <typename TSystem, typename... Args>
+		const TSystem& create_system(Args&&... args)
+		{
+			static_assert(std::is_base_of<system, TSystem>::value, "type parameter of this class must derive from system");
+			m_systems.push_back(std::make_unique<TSystem>(*this, std::forward<Args>(args)...));
+			return *dynamic_cast<TSystem*>(m_systems.back().get());
+		}
+
+		// Folds every entity holding the components fn takes into one value, in parallel on the
+		// pool. fn(T& accumulator, const entity&, const Components&...) adds a row to a partial
+		// result and combine(T& accumulator, const T& other) merges two. identity seeds every
+		// partial, so it must leave whatever it is combined with unchanged.
+		template <typename T, typename Fn, typename Combine>
+		T reduce(const T& identity, Fn&& fn, Combine&& combine, const reduce_order order = reduce_order::fast, const std::size_t chunk_size = 4096)
+		{
+			typedef function_traits<decltype(fn)> traits;
+			typename traits::self t;
+			return reduce_query(identity, fn, combine, order, chunk_size, t);
+		}
+
+		// Like std::transform_reduce over the query: transform(const entity&, const Components&...)
+		// maps a row to a T and combine(const T&, const T&) returns their sum, which must be
+		// associative with identity as its neutral element.
+		template <typename T, typename Transform, typename Combine>
+		T transform_reduce(const T& identity, Transform&& transform, Combine&& combine, const reduce_order order = reduce_order::fast, const std::size_t chunk_size = 4096)
+		{
+			typedef function_traits<decltype(transform)> traits;
+			typename traits::self t;
+			return transform_reduce_query(identity, transform, combine, order, chunk_size, t);
+		}
+
+		// Creates or truncates the file cold archetypes are paged into; archetypes
+		// frozen in a previous store are woken first.
+		bool set_cold_store(const std::string& path)
+		{
+			wake<>();
+			return m_cold_store.open(path);
+		}
+
+		// Pages the columns of every archetype holding all of TComponents out to the cold
+		// store, so tagging entities with an empty component freezes them by tag. Cold
+		// entities keep their ids and rows but are skipped by queries, views, reductions and
+		// world views until they are touched through get, emplace, remove, destroy and the
+		// like, which pages their whole archetype back in, or until wake(). Archetypes
+		// owned by a group or holding components that are not trivially copyable stay
+		// resident. Returns the number of entities paged out.
+		template <typename... TComponents>
+		std::size_t freeze()
+		{
+			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+			if (!m_cold_store.is_open())
+				return 0;
+			std::size_t frozen = 0;
+			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
+			{
+				archetype* context = m_archetypes[i].get();
+				if (context->has_all<TComponents...>() && page_out(*context))
+					frozen += context->m_entities.size();
+			}
+			return frozen;
+		}
+
+		// Pages every cold archetype holding all of TComponents back in. Returns the number
+		// of entities woken.
+		template <typename... TComponents>
+		std::size_t wake()
+		{
+			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+			std::size_t woken = 0;
+			for (auto& context : m_archetypes)
+			{
+				if (context->is_cold() && context->has_all<TComponents...>())
 				{
-					s << " not valid\n";
-					//std::cout << s.str();
+					page_in(*context);
+					woken += context->m_entities.size();
 				}
-				for (auto& query : queries)
+			}
+			return woken;
+		}
+
+		void wake(const entity& entity)
+		{
+			resident(m_archetypes[m_entity_index[entity]].get());
+		}
+
+		bool is_cold(const entity& entity) const
+		{
+			return m_archetypes[m_entity_index[entity]]->is_cold();
+		}
+
+		// Bytes of paged out columns held by the cold store.
+		inline std::size_t cold_size() const
+		{
+			return m_cold_store.size();
+		}
+
+		// Keeps the rows of archetypes holding all TComponents sorted by entity id so lookups
+		// binary-search them. Removing from such archetypes preserves order and is O(n).
+		template <typename... TComponents>
+		void sort_by_entity()
+		{
+			add_order_rule([](archetype& archetype) {
+				if (archetype.has_all<TComponents...>())
+					archetype.set_order(nullptr);
+			});
+		}
+
+		// Keeps the rows of archetypes holding TComponent ordered by less(const TComponent&, const TComponent&).
+		// Rows are placed by their value when inserted, call sort() after changing keys in place.
+		template <typename TComponent, typename Compare>
+		void sort_by(Compare less)
+		{
+			add_order_rule([less](archetype& archetype) {
+				if (archetype.has_all<TComponent>())
 				{
-					query();
+					archetype.set_order([less](apollo::archetype& a, const std::size_t lhs, const std::size_t rhs) {
+						const TComponent& l = a.get_component_at<TComponent>(lhs);
+						const TComponent& r = a.get_component_at<TComponent>(rhs);
+						return less(l, r);
+					});
 				}
 			});
 		}
 
-		template <typename TSystem, typename... Args>
-		const TSystem& create_system(Args&&... args)
+		void sort()
 		{
-			static_assert(std::is_base_of<system, TSystem>::value, "type parameter of this class must derive from system");
-			m_systems.push_back(std::make_unique<TSystem>(*this, std::forward<Args>(args)...));
-			return *dynamic_cast<TSystem*>(m_systems.back().get());
+			for (auto& archetype : m_archetypes)
+			{
+				if (archetype->is_sorted() && !archetype->is_cold())
+					archetype->sort();
+			}
+		}
+
+		// Plays buffer back like command_buffer::execute, but each run of structural commands
+		// (destroy, remove) is applied at once: every entity goes straight to its final archetype,
+		// rows move in bulk grouped by source archetype, and groups touching disjoint archetypes
+		// run in parallel on the pool. Observers fire afterwards, in command order.
+		void execute(const command_buffer& buffer)
+		{
+			APOLLO_TRACE_SCOPE("registry::execute", "command");
+			playback_plan plan;
+			entity e;
+			id_type component;
+			for (const auto& command : buffer.get_commands())
+			{
+				if (command->describe(e, component))
+				{
+					plan_change(plan, e, component);
+					continue;
+				}
+				apply_plan(plan);
+				command->execute();
+			}
+			apply_plan(plan);
 		}
 
 		command_buffer create_command_buffer()
@@ -221,11 +1279,84 @@ namespace apollo
 			return command_buffer(this);
 		}
 
+		template <typename Fn>
+		job create_job(Fn&& fn)
+		{
+			return job(&m_thread_pool, std::forward<Fn>(fn));
+		}
+
+		// Lets queued jobs of higher lanes run on this thread; long background jobs call it
+		// between chunks of work. Queries and reductions already do.
+		inline bool preempt()
+		{
+			return m_thread_pool.preempt();
+		}
+
+		// Moves the rows of entities into target as new entities, written to migrated in the
+		// same order, and frees them here. Entities no longer valid are skipped and get
+		// invalid_index in migrated. Neither registry's observers are notified, indexes are
+		// kept up to date.
+		void migrate(const std::vector<entity>& entities, registry& target, std::vector<entity>& migrated)
+		{
+			migrated.clear();
+			migrated.reserve(entities.size());
+			archetype* context = nullptr;
+			archetype* destination = nullptr;
+			for (entity source : entities)
+			{
+				if (!valid(source))
+				{
+					migrated.push_back(invalid_index);
+					continue;
+				}
+				const entity moved = target.create();
+				migrated.push_back(moved);
+				if (m_entity_index[source] != 0)
+				{
+					archetype* current = resident(m_archetypes[m_entity_index[source]].get());
+					if (current != context)
+					{
+						context = current;
+						destination = target.find_archetype_with_same_signature(*context);
+						if (destination)
+							target.resident(destination);
+						else
+						{
+							storage_vec storages;
+							for (const auto& s : context->m_storages)
+								storages.push_back(s->create(target.m_resource));
+							destination = archetype::make(target.m_resource, target.m_archetypes.size(), storages);
+							target.m_archetypes.emplace_back(destination);
+							target.apply_archetype_rules(*destination);
+						}
+					}
+					const std::size_t index = context->search(source);
+					destination->add(moved);
+					for (const auto& s : context->m_storages)
+						s->move(*destination->get_storage(s->get_id()), index);
+					destination->set_version_at(destination->m_entities.size() - 1, target.m_tick);
+					target.m_entity_index[moved] = destination->get_id();
+					for (auto& i : target.m_indexes)
+						i->insert_row(*destination, destination->m_entities.size() - 1);
+					context->erase_row(index);
+					m_counters.m_archetype_moves.increment();
+				}
+				for (auto& i : m_indexes)
+					i->erase(source);
+				m_entity_index[source] = invalid_index;
+				m_entity_ticks[source] = m_tick;
+				destroyed_entities.push_back(source);
+			}
+			for (auto& archetype : target.m_archetypes)
+				archetype->maintain_order();
+			target.maintain_groups();
+		}
+
 		template <typename TComponent, typename... Args>
-		TComponent& emplace(entity entity, Args&&... args)
+		component_reference_t<TComponent> emplace(entity entity, Args&&... args)
 		{
 			static_assert(std::is_base_of<component<TComponent>, TComponent>::value, "type parameter of this class must derive from component");
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 			archetype* new_archetype = context->get_edge(TComponent::id);
 
 			if (!new_archetype)
@@ -239,24 +1370,36 @@ namespace apollo
 				{
 					new_archetype = context->with_added_component<TComponent>(m_archetypes.size());
 					m_archetypes.emplace_back(new_archetype);
+					apply_archetype_rules(*new_archetype);
 				}
 				else
 				{
 					new_archetype = existing_archetype;
-					context->m_edges[TComponent::id] = existing_archetype;
-					existing_archetype->m_edges[TComponent::id] = context;
+					context->set_edge(TComponent::id, existing_archetype);
+					existing_archetype->set_edge(TComponent::id, context);
 				}
 			}
+			resident(new_archetype);
 			m_entity_index[entity] = new_archetype->get_id();
+			m_entity_ticks[entity] = m_tick;
+			m_counters.m_archetype_moves.increment();
 			new_archetype->add(entity);
 			new_archetype->set_at<TComponent>(new_archetype->m_entities.size() - 1, std::forward<Args>(args)...);
+			new_archetype->set_version_at(new_archetype->m_entities.size() - 1, m_tick);
 			context->move<TComponent>(*new_archetype, entity);
+			maintain_groups();
+			std::size_t index = new_archetype->m_entities.size() - 1;
+			if (new_archetype->maintain_order())
+				index = new_archetype->search(entity);
 
 			auto it = m_on_construct_observers.find(TComponent::id);
 			if (it != m_on_construct_observers.end())
+			{
+				m_counters.m_observer_notifications.increment();
 				it->second.notify(*this, entity);
+			}
 
-			return new_archetype->get_component_at<TComponent>(new_archetype->m_entities.size() - 1);
+			return new_archetype->get_component_at<TComponent>(index);
 		}
 
 		template <typename TComponent>
@@ -265,55 +1408,181 @@ namespace apollo
 			static_assert(std::is_base_of<component<TComponent>, TComponent>::value, "type parameter of this class must derive from component");
 			if (m_entity_index[entity])
 			{
-				archetype* context = m_archetypes[m_entity_index[entity]].get();
+				archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 				if (!context->has_all<TComponent>())
 					return;
-				archetype* new_archetype = context->get_edge(TComponent::id);
-
-				if (!new_archetype)
-				{
-					archetype temp{ 0 };
-					temp.m_signature = context->m_signature;
-					temp.remove_from_signature(TComponent::id);
-
-					archetype* existing_archetype = find_archetype_with_same_signature(temp);
-					if (!existing_archetype)
-					{
-						new_archetype = context->with_removed_component<TComponent>(m_archetypes.size());
-						m_archetypes.emplace_back(new_archetype);
-					}
-					else
-					{
-						new_archetype = existing_archetype;
-						context->m_edges[TComponent::id] = existing_archetype;
-						existing_archetype->m_edges[TComponent::id] = context;
-					}
-				}
+				archetype* new_archetype = archetype_without<TComponent>(context);
 				m_entity_index[entity] = new_archetype->get_id();
+				m_entity_ticks[entity] = m_tick;
+				m_counters.m_archetype_moves.increment();
 				new_archetype->add(entity);
+				new_archetype->set_version_at(new_archetype->m_entities.size() - 1, m_tick);
 				context->move<TComponent>(*new_archetype, entity);
+				new_archetype->maintain_order();
+				maintain_groups();
 
 				auto it = m_on_destroy_observers.find(TComponent::id);
 				if (it != m_on_destroy_observers.end())
+				{
+					m_counters.m_observer_notifications.increment();
 					it->second.notify(*this, entity);
+				}
 			}
 		}
 
+		// Destroys every entity holding all of TComponents, or every entity with at least one
+		// component when TComponents is empty. Whole archetypes are truncated in one pass and
+		// destroy observers are notified once per archetype and component.
 		template <typename... TComponents>
-		void clear()
+		std::size_t destroy_all()
 		{
 			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
-			for (std::size_t i = 0; i < m_entity_index.size(); ++i)
-				((remove<TComponents>(i)), ...);
+			std::size_t destroyed = 0;
+			std::vector<entity> entities;
+			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
+			{
+				archetype* context = m_archetypes[i].get();
+				if (context->m_entities.empty() || !context->has_all<TComponents...>())
+					continue;
+				entities.assign(context->m_entities.begin(), context->m_entities.end());
+				discard_page(*context);
+				context->clear();
+				release_entities(*context, entities);
+				destroyed += entities.size();
+			}
+			maintain_groups();
+			return destroyed;
 		}
 
-		void clear()
+		// Destroys every entity for which pred(const entity&, const T&...) returns true, among the
+		// entities holding all of T. Matching archetypes are paged in if cold and compacted in
+		// one pass each.
+		template <typename Fn>
+		std::size_t destroy_if(Fn&& pred)
 		{
-			for (std::size_t i = 0; i < m_entity_index.size(); ++i)
+			typedef function_traits<decltype(pred)> traits;
+			typename traits::self t;
+			std::size_t destroyed = 0;
+			std::vector<std::size_t> rows;
+			std::vector<std::size_t> rest;
+			std::vector<entity> entities;
+			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
+			{
+				archetype* context = m_archetypes[i].get();
+				if (context->m_entities.empty() || !archetype_holds_query_args_with_entity(context, t))
+					continue;
+				select_rows(resident(context), pred, t, rows, rest);
+				if (rows.empty())
+					continue;
+				entities.clear();
+				for (std::size_t row : rows)
+					entities.push_back(context->m_entities[row]);
+				if (rest.empty())
+					context->clear();
+				else
+					context->retain(rest);
+				release_entities(*context, entities);
+				destroyed += entities.size();
+			}
+			maintain_groups();
+			return destroyed;
+		}
+
+		// Removes TComponent from every entity that holds it and all of With, moving whole
+		// archetypes column by column. Destroy observers of TComponent are notified once per archetype.
+		template <typename TComponent, typename... With>
+		std::size_t remove_all()
+		{
+			static_assert(std::is_base_of<component<TComponent>, TComponent>::value, "type parameter of this class must derive from component");
+			std::size_t removed = 0;
+			std::vector<std::size_t> rows;
+			const std::size_t count = m_archetypes.size();
+			for (std::size_t i = 1; i < count; ++i)
+			{
+				archetype* context = m_archetypes[i].get();
+				if (context->m_entities.empty() || !context->has_all<TComponent, With...>())
+					continue;
+				resident(context);
+				rows.resize(context->m_entities.size());
+				std::iota(rows.begin(), rows.end(), 0);
+				removed += remove_rows<TComponent>(context, rows, {});
+			}
+			maintain_groups();
+			return removed;
+		}
+
+		// Removes TComponent from every entity holding it and the arguments of pred for which
+		// pred(const entity&, const T&...) returns true. Cold matching archetypes are paged in.
+		template <typename TComponent, typename Fn>
+		std::size_t remove_if(Fn&& pred)
+		{
+			static_assert(std::is_base_of<component<TComponent>, TComponent>::value, "type parameter of this class must derive from component");
+			typedef function_traits<decltype(pred)> traits;
+			typename traits::self t;
+			std::size_t removed = 0;
+			std::vector<std::size_t> rows;
+			std::vector<std::size_t> rest;
+			const std::size_t count = m_archetypes.size();
+			for (std::size_t i = 1; i < count; ++i)
 			{
-				if (m_entity_index[i] != invalid_index && m_entity_index[i] != 0)
-					destroy(i);
+				archetype* context = m_archetypes[i].get();
+				if (context->m_entities.empty() || !context->has_all<TComponent>() || !archetype_holds_query_args_with_entity(context, t))
+					continue;
+				select_rows(resident(context), pred, t, rows, rest);
+				if (!rows.empty())
+					removed += remove_rows<TComponent>(context, rows, rest);
 			}
+			maintain_groups();
+			return removed;
+		}
+
+		// Creates count entities holding copies of source's components, written to instances.
+		// The archetype is resolved once and every column grows once; construct observers are
+		// notified once per component.
+		void instantiate(const entity source, const std::size_t count, std::vector<entity>& instances)
+		{
+			archetype* context = resident(m_archetypes[m_entity_index[source]].get());
+			const std::size_t index = context->search(source);
+			spawn(context, count, instances, [context, index, count]() {
+				for (auto& s : context->m_storages)
+					s->fill(index, count);
+			});
+		}
+
+		template <typename... TComponents>
+		void instantiate(const prefab<TComponents...>& prefab, const std::size_t count, std::vector<entity>& instances)
+		{
+			archetype* target = archetype_with<TComponents...>();
+			spawn(target, count, instances, [target, &prefab, count]() {
+				((target->get_storage<TComponents>()->append_copies(prefab.template get<TComponents>(), count)), ...);
+			});
+		}
+
+		template <typename... TComponents>
+		entity instantiate(const prefab<TComponents...>& prefab)
+		{
+			std::vector<entity> instances;
+			instantiate(prefab, 1, instances);
+			return instances.front();
+		}
+
+		entity clone(const entity source)
+		{
+			std::vector<entity> instances;
+			instantiate(source, 1, instances);
+			return instances.front();
+		}
+
+		template <typename... TComponents>
+		void clear()
+		{
+			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+			((remove_all<TComponents>()), ...);
+		}
+
+		void clear()
+		{
+			destroy_all<>();
 		}
 
 		template <typename Fn>
@@ -321,12 +1590,15 @@ namespace apollo
 		{
 			if (m_entity_index[entity])
 			{
-				archetype* context = m_archetypes[m_entity_index[entity]].get();
+				archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 				typedef function_traits<decltype(fn)> traits;
-				if (archetype_has_all_query_args_without_entity(context, traits::self()))
+				typename traits::self t;
+				std::size_t index = context->search(entity);
+				if (index < context->m_entities.size() && archetype_has_all_query_args_without_entity(context, t))
 				{
-					apply_to_archetype_entity_components(context, fn, traits::self(), entity);
-					apply_to_on_update_observers(entity, traits::self());
+					apply_to_archetype_entity_components(context, fn, t, index);
+					context->set_version_at(index, m_tick);
+					apply_to_on_update_observers(entity, t);
 				}
 			}
 		}
@@ -336,12 +1608,19 @@ namespace apollo
 		{
 			if (m_entity_index[entity])
 			{
-				archetype* context = m_archetypes[m_entity_index[entity]].get();
-				context->set<TComponent>(entity, std::forward<Args>(args)...);
+				archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
+				std::size_t index = context->search(entity);
+				if (index >= context->m_entities.size())
+					return;
+				context->set_at<TComponent>(index, std::forward<Args>(args)...);
+				context->set_version_at(index, m_tick);
 
 				auto it = m_on_update_observers.find(TComponent::id);
 				if (it != m_on_update_observers.end())
+				{
+					m_counters.m_observer_notifications.increment();
 					it->second.notify(*this, entity);
+				}
 			}
 		}
 
@@ -362,33 +1641,56 @@ namespace apollo
 		}
 
 		template <typename TComponent>
-		TComponent& get(const entity& entity)
+		component_reference_t<TComponent> get(const entity& entity)
 		{
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 			return context->get_component<TComponent>(entity);
 		}
 
 		template <typename TComponent>
 		TComponent* try_get(const entity& entity)
 		{
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 			return context->try_get_component<TComponent>(entity);
 		}
 
 		template <typename... TComponents>
-		std::tuple<TComponents&...> get(const entity& entity)
+		std::tuple<component_reference_t<TComponents>...> get(const entity& entity)
 		{
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 			return context->get_components<TComponents...>(entity);
 		}
 
 		template <typename... TComponents>
 		auto try_get(const entity& entity)
 		{
-			archetype* context = m_archetypes[m_entity_index[entity]].get();
+			archetype* context = resident(m_archetypes[m_entity_index[entity]].get());
 			return context->try_get_components<TComponents...>(entity);
 		}
 
+		// Lazy range of (entity, TComponents&...) over the matching archetypes, see apollo::view.
+		// Rows reached through it are stamped with the current tick, so writes show up in
+		// deltas and world views like those of a query; sorted archetypes are merged first.
+		template <typename... TComponents>
+		apollo::view<TComponents...> view()
+		{
+			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
+			{
+				archetype* archetype = m_archetypes[i].get();
+				if (!archetype->is_cold() && archetype->has_all<std::remove_const_t<TComponents>...>())
+					archetype->merge_sorted_tail();
+			}
+			return apollo::view<TComponents...>(m_archetypes.data() + 1, m_archetypes.data() + m_archetypes.size(), m_tick);
+		}
+
+		// Read-only lazy range of (entity, const TComponents&...), stamping nothing. Rows added
+		// to sorted archetypes since their last merge come after the sorted ones.
+		template <typename... TComponents>
+		apollo::view<const TComponents...> view() const
+		{
+			return apollo::view<const TComponents...>(m_archetypes.data() + 1, m_archetypes.data() + m_archetypes.size());
+		}
+
 		template <typename... TComponents>
 		std::vector<entity> get_entities() const
 		{
@@ -396,9 +1698,9 @@ namespace apollo
 			for (std::size_t i = 1; i < m_archetypes.size(); ++i)
 			{
 				auto& archetype = m_archetypes[i];
-				if (archetype->has_all<TComponents...>())
+				if (!archetype->is_cold() && archetype->has_all<TComponents...>())
 				{
-					entities.insert(archetype->m_entities.begin(), archetype->m_entities.end());
+					entities.insert(entities.end(), archetype->m_entities.begin(), archetype->m_entities.end());
 				}
 			}
 			return entities;
@@ -415,6 +1717,494 @@ namespace apollo
 			return entities;
 		}
 
+		bool save(const std::string& path) const
+		{
+			// checked before the writer truncates an existing snapshot
+			for (const auto& archetype : m_archetypes)
+			{
+				for (const auto& storage : archetype->m_storages)
+				{
+					if (!storage->trivially_copyable())
+						return false;
+				}
+			}
+			snapshot_writer writer(path);
+			if (!writer.good())
+				return false;
+			writer.write(snapshot_magic);
+			writer.write(snapshot_version);
+			writer.write(m_tick);
+			writer.write_vector(m_entity_index);
+			writer.write_vector(destroyed_entities);
+			writer.write<std::uint64_t>(m_archetypes.size());
+			for (const auto& archetype : m_archetypes)
+			{
+				writer.write<std::uint64_t>(archetype->m_storages.size());
+				writer.write_vector(archetype->m_entities);
+				for (std::size_t i = 0; i < archetype->m_storages.size(); ++i)
+				{
+					const auto& storage = archetype->m_storages[i];
+					writer.write<std::uint64_t>(storage->get_hash());
+					writer.write<std::uint64_t>(storage->element_size());
+					writer.write_bytes(column_data(*archetype, i), archetype->m_entities.size() * storage->element_size());
+				}
+			}
+			return writer.flush();
+		}
+
+		template <typename... TComponents>
+		bool load(const std::string& path)
+		{
+			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+			static_assert(((std::is_trivially_copyable<TComponents>::value) && ...), "type parameters TComponents must be trivially copyable");
+			static_assert(type_list_signature<TComponents...>::collision_free, "two component types hash to the same type id, rename one of them");
+			mapped_file file(path);
+			if (!file.valid())
+				return false;
+			snapshot_reader reader(file.data(), file.size());
+			if (reader.read<std::uint32_t>() != snapshot_magic || reader.read<std::uint32_t>() != snapshot_version)
+				return false;
+			const std::uint64_t tick = reader.read<std::uint64_t>();
+
+			storage_vec prototypes;
+			(prototypes.push_back(std::make_unique<component_storage_impl<TComponents>>()), ...);
+
+			std::vector<std::size_t> entity_index;
+			std::vector<entity> destroyed;
+			reader.read_vector(entity_index);
+			reader.read_vector(destroyed);
+			std::vector<archetype_ptr> archetypes;
+			const std::size_t num_archetypes = static_cast<std::size_t>(reader.read<std::uint64_t>());
+			for (std::size_t i = 0; i < num_archetypes && reader.good(); ++i)
+			{
+				const std::size_t num_storages = static_cast<std::size_t>(reader.read<std::uint64_t>());
+				std::vector<entity> entities;
+				reader.read_vector(entities);
+				storage_vec storages;
+				for (std::size_t j = 0; j < num_storages && reader.good(); ++j)
+				{
+					const std::uint64_t component_hash = reader.read<std::uint64_t>();
+					const std::size_t element_size = static_cast<std::size_t>(reader.read<std::uint64_t>());
+					auto prototype = std::find_if(prototypes.begin(), prototypes.end(), [component_hash](auto&& s) {
+						return s->get_hash() == component_hash;
+					});
+					if (prototype == prototypes.end() || (*prototype)->element_size() != element_size)
+						return false;
+					const std::byte* bytes = reader.read_bytes(entities.size() * element_size);
+					if (!bytes)
+						return false;
+					storages.push_back((*prototype)->create(m_resource));
+					storages.back()->assign(bytes, entities.size());
+				}
+				archetypes.emplace_back(archetype::make(m_resource, i, storages));
+				archetypes.back()->m_versions.assign(entities.size(), tick);
+				archetypes.back()->m_entities.assign(entities.begin(), entities.end());
+			}
+			if (!reader.good() || archetypes.empty())
+				return false;
+
+			m_archetypes = std::move(archetypes);
+			m_cold_store.reset();
+			for (auto& group : m_groups)
+				group->clear_members();
+			for (auto& archetype : m_archetypes)
+				apply_archetype_rules(*archetype);
+			maintain_groups();
+			rebuild_indexes();
+			m_entity_index = std::move(entity_index);
+			m_entity_ticks.assign(m_entity_index.size(), tick);
+			destroyed_entities = std::move(destroyed);
+			m_tick = tick;
+			return true;
+		}
+
+		bool save_delta(std::vector<std::byte>& buffer, const std::uint64_t since) const
+		{
+			// checked before anything is appended to buffer
+			std::vector<archetype*> changed;
+			for (const auto& archetype : m_archetypes)
+			{
+				if (std::none_of(archetype->m_versions.begin(), archetype->m_versions.end(), [since](auto v) { return v >= since; }))
+					continue;
+				for (const auto& storage : archetype->m_storages)
+				{
+					if (!storage->trivially_copyable())
+						return false;
+				}
+				changed.push_back(archetype.get());
+			}
+			snapshot_writer writer(buffer);
+			std::vector<entity> destroyed;
+			std::vector<entity> orphans;
+			for (std::size_t i = 0; i < m_entity_index.size(); ++i)
+			{
+				if (m_entity_ticks[i] < since)
+					continue;
+				if (m_entity_index[i] == invalid_index)
+					destroyed.push_back(i);
+				else if (m_entity_index[i] == 0)
+					orphans.push_back(i);
+			}
+			std::size_t num_entities = m_entity_index.size();
+			if (since <= m_trim_tick && m_trimmed_size > num_entities)
+			{
+				for (entity e = num_entities; e < m_trimmed_size; ++e)
+					destroyed.push_back(e);
+				num_entities = m_trimmed_size;
+			}
+			writer.write(delta_magic);
+			writer.write(snapshot_version);
+			writer.write(since);
+			writer.write(m_tick);
+			writer.write<std::uint64_t>(num_entities);
+			writer.write_vector(destroyed);
+			writer.write_vector(orphans);
+
+			writer.write<std::uint64_t>(changed.size());
+			std::vector<std::size_t> rows;
+			std::vector<entity> entities;
+			for (archetype* archetype : changed)
+			{
+				rows.clear();
+				entities.clear();
+				for (std::size_t i = 0; i < archetype->m_versions.size(); ++i)
+				{
+					if (archetype->m_versions[i] >= since)
+					{
+						rows.push_back(i);
+						entities.push_back(archetype->m_entities[i]);
+					}
+				}
+				writer.write<std::uint64_t>(archetype->m_storages.size());
+				writer.write_vector(entities);
+				for (std::size_t i = 0; i < archetype->m_storages.size(); ++i)
+				{
+					const auto& storage = archetype->m_storages[i];
+					const std::size_t element_size = storage->element_size();
+					const std::byte* data = static_cast<const std::byte*>(column_data(*archetype, i));
+					writer.write<std::uint64_t>(storage->get_hash());
+					writer.write<std::uint64_t>(element_size);
+					if (rows.size() == archetype->m_entities.size())
+					{
+						writer.write_bytes(data, rows.size() * element_size);
+						continue;
+					}
+					for (std::size_t row : rows)
+						writer.write_bytes(data + row * element_size, element_size);
+				}
+			}
+			return writer.flush();
+		}
+
+		template <typename... TComponents>
+		bool apply_delta(const std::byte* data, const std::size_t size)
+		{
+			static_assert(((std::is_base_of<component<TComponents>, TComponents>::value) && ...), "type parameters TComponents must derive from component");
+			static_assert(((std::is_trivially_copyable<TComponents>::value) && ...), "type parameters TComponents must be trivially copyable");
+			static_assert(type_list_signature<TComponents...>::collision_free, "two component types hash to the same type id, rename one of them");
+			snapshot_reader reader(data, size);
+			if (reader.read<std::uint32_t>() != delta_magic || reader.read<std::uint32_t>() != snapshot_version)
+				return false;
+			reader.read<std::uint64_t>();
+			const std::uint64_t tick = reader.read<std::uint64_t>();
+			const std::size_t num_entities = static_cast<std::size_t>(reader.read<std::uint64_t>());
+			std::vector<entity> destroyed;
+			std::vector<entity> orphans;
+			reader.read_vector(destroyed);
+			reader.read_vector(orphans);
+			if (!reader.good())
+				return false;
+
+			storage_vec prototypes;
+			(prototypes.push_back(std::make_unique<component_storage_impl<TComponents>>()), ...);
+
+			wake<>();
+			if (m_entity_index.size() < num_entities)
+			{
+				m_entity_index.resize(num_entities, invalid_index);
+				m_entity_ticks.resize(num_entities, tick);
+			}
+			bool recycled = !destroyed.empty();
+			auto detach = [this, &recycled](const entity e) {
+				const std::size_t index = m_entity_index[e];
+				if (index == invalid_index)
+					recycled = true;
+				else if (index != 0)
+					m_archetypes[index]->remove(e);
+			};
+			for (entity e : destroyed)
+			{
+				if (e >= num_entities)
+					return false;
+				detach(e);
+				m_entity_index[e] = invalid_index;
+				m_entity_ticks[e] = tick;
+			}
+			for (entity e : orphans)
+			{
+				if (e >= num_entities)
+					return false;
+				detach(e);
+				m_entity_index[e] = 0;
+				m_entity_ticks[e] = tick;
+			}
+
+			const std::size_t num_archetypes = static_cast<std::size_t>(reader.read<std::uint64_t>());
+			std::vector<entity> entities;
+			std::vector<std::pair<id_type, const std::byte*>> columns;
+			for (std::size_t i = 0; i < num_archetypes && reader.good(); ++i)
+			{
+				const std::size_t num_storages = static_cast<std::size_t>(reader.read<std::uint64_t>());
+				reader.read_vector(entities);
+				columns.clear();
+				archetype signature{ 0 };
+				for (std::size_t j = 0; j < num_storages && reader.good(); ++j)
+				{
+					const std::uint64_t component_hash = reader.read<std::uint64_t>();
+					const std::size_t element_size = static_cast<std::size_t>(reader.read<std::uint64_t>());
+					auto prototype = std::find_if(prototypes.begin(), prototypes.end(), [component_hash](auto&& s) {
+						return s->get_hash() == component_hash;
+					});
+					if (prototype == prototypes.end() || (*prototype)->element_size() != element_size)
+						return false;
+					const std::byte* bytes = reader.read_bytes(entities.size() * element_size);
+					if (!bytes)
+						return false;
+					columns.emplace_back((*prototype)->get_id(), bytes);
+					signature.add_to_signature(j, (*prototype)->get_id());
+				}
+				if (!reader.good())
+					return false;
+
+				archetype* target = find_archetype_with_same_signature(signature);
+				if (!target)
+				{
+					storage_vec storages;
+					for (const auto& column : columns)
+					{
+						auto prototype = std::find_if(prototypes.begin(), prototypes.end(), [&column](auto&& s) {
+							return s->get_id() == column.first;
+						});
+						storages.push_back((*prototype)->create(m_resource));
+					}
+					target = archetype::make(m_resource, m_archetypes.size(), storages);
+					m_archetypes.emplace_back(target);
+					apply_archetype_rules(*target);
+				}
+
+				for (std::size_t row = 0; row < entities.size(); ++row)
+				{
+					const entity e = entities[row];
+					if (e >= num_entities)
+						return false;
+					std::size_t index;
+					if (m_entity_index[e] == target->get_id())
+					{
+						index = target->search(e);
+					}
+					else
+					{
+						detach(e);
+						target->add(e);
+						index = target->m_entities.size() - 1;
+						m_entity_index[e] = target->get_id();
+						m_entity_ticks[e] = tick;
+					}
+					for (const auto& column : columns)
+					{
+						component_storage* storage = target->get_storage(column.first);
+						storage->assign_at(index, column.second + row * storage->element_size());
+					}
+					target->set_version_at(index, tick);
+				}
+				target->maintain_order();
+			}
+			if (!reader.good())
+				return false;
+			maintain_groups();
+			rebuild_indexes();
+
+			if (recycled)
+			{
+				destroyed_entities.clear();
+				for (std::size_t i = 0; i < m_entity_index.size(); ++i)
+				{
+					if (m_entity_index[i] == invalid_index)
+						destroyed_entities.push_back(i);
+				}
+			}
+			m_tick = std::max(m_tick, tick);
+			return true;
+		}
+
+		template <typename... TComponents>
+		bool apply_delta(const std::vector<std::byte>& buffer)
+		{
+			return apply_delta<TComponents...>(buffer.data(), buffer.size());
+		}
+
+		std::shared_ptr<const world_view> publish_world_view()
+		{
+			std::shared_ptr<const world_view> previous = std::atomic_load(&m_world_view);
+			auto view = std::make_shared<world_view>();
+			view->m_tick = m_tick;
+			view->m_archetypes.resize(m_archetypes.size());
+			for (std::size_t i = 0; i < m_archetypes.size(); ++i)
+			{
+				const archetype& source = *m_archetypes[i];
+				world_view::archetype_view& target = view->m_archetypes[i];
+				target.m_size = source.is_cold() ? 0 : source.m_entities.size();
+				for (const auto& storage : source.m_storages)
+				{
+					target.m_signature.push_back(storage->get_id());
+					target.m_columns.push_back({ storage->get_id(), {} });
+				}
+
+				const world_view::archetype_view* base = nullptr;
+				if (previous && i < previous->m_archetypes.size() && previous->m_archetypes[i].m_signature == target.m_signature)
+					base = &previous->m_archetypes[i];
+
+				const std::size_t num_chunks = (target.m_size + world_view_chunk_size - 1) / world_view_chunk_size;
+				for (std::size_t c = 0; c < num_chunks; ++c)
+				{
+					const std::size_t begin = c * world_view_chunk_size;
+					const std::size_t count = std::min(world_view_chunk_size, target.m_size - begin);
+					const bool clean = base && c < base->m_entities.size() &&
+						std::equal(source.m_entities.begin() + begin, source.m_entities.begin() + begin + count,
+							base->m_entities[c]->begin(), base->m_entities[c]->end()) &&
+						std::none_of(source.m_versions.begin() + begin, source.m_versions.begin() + begin + count, [&previous](auto v) {
+							return v >= previous->m_tick;
+						});
+					if (clean)
+					{
+						target.m_entities.push_back(base->m_entities[c]);
+						for (std::size_t j = 0; j < target.m_columns.size(); ++j)
+							target.m_columns[j].m_chunks.push_back(base->m_columns[j].m_chunks[c]);
+					}
+					else
+					{
+						target.m_entities.push_back(std::make_shared<const std::vector<entity>>(source.m_entities.begin() + begin, source.m_entities.begin() + begin + count));
+						for (std::size_t j = 0; j < target.m_columns.size(); ++j)
+							target.m_columns[j].m_chunks.push_back(source.m_storages[j]->clone_range(begin, count));
+					}
+				}
+			}
+			std::shared_ptr<const world_view> published = std::move(view);
+			std::atomic_store(&m_world_view, published);
+			return published;
+		}
+
+		std::shared_ptr<const world_view> get_world_view() const
+		{
+			return std::atomic_load(&m_world_view);
+		}
+
+		registry_stats stats() const
+		{
+			registry_stats result;
+			for (const auto& archetype : m_archetypes)
+			{
+				archetype_stats a;
+				a.m_id = archetype->get_id();
+				a.m_num_entities = archetype->m_entities.size();
+				a.m_entity_capacity = archetype->m_entities.capacity();
+				a.m_size_bytes = a.m_num_entities * (sizeof(entity) + sizeof(std::uint64_t));
+				a.m_capacity_bytes = a.m_entity_capacity * sizeof(entity) + archetype->m_versions.capacity() * sizeof(std::uint64_t);
+				for (const auto& storage : archetype->m_storages)
+				{
+					column_stats c{ storage->get_id(), storage->size() * storage->element_size(), storage->capacity() * storage->element_size() };
+					a.m_size_bytes += c.m_size_bytes;
+					a.m_capacity_bytes += c.m_capacity_bytes;
+					a.m_columns.push_back(c);
+				}
+				a.m_edges = archetype->m_edges.size();
+				a.m_edge_capacity = archetype->m_edges.capacity();
+				a.m_capacity_bytes += a.m_edge_capacity * sizeof(std::pair<id_type, void*>) + archetype->m_signature.capacity() * sizeof(id_type);
+				result.m_num_entities += a.m_num_entities;
+				result.m_size_bytes += a.m_size_bytes;
+				result.m_capacity_bytes += a.m_capacity_bytes;
+				result.m_archetypes.push_back(std::move(a));
+			}
+			result.m_num_recyclable = destroyed_entities.size();
+			result.m_capacity_bytes += m_entity_index.capacity() * sizeof(std::size_t) + m_entity_ticks.capacity() * sizeof(std::uint64_t) + destroyed_entities.capacity() * sizeof(entity);
+			result.m_archetype_moves = m_counters.m_archetype_moves.get();
+			result.m_observer_notifications = m_counters.m_observer_notifications.get();
+			result.m_query_matches = m_counters.m_query_matches.get();
+			result.m_entity_recycles = m_counters.m_entity_recycles.get();
+			return result;
+		}
+
+		void reset_stats()
+		{
+			m_counters.m_archetype_moves.reset();
+			m_counters.m_observer_notifications.reset();
+			m_counters.m_query_matches.reset();
+			m_counters.m_entity_recycles.reset();
+		}
+
+		// Must be called at a sync point, with no query jobs in flight.
+		void compact(const compact_policy& policy = {})
+		{
+			if (policy.m_free_empty_archetypes)
+			{
+				auto freed = [](const archetype* a) {
+					return a->get_id() != 0 && a->m_entities.empty();
+				};
+				std::vector<archetype_ptr> archetypes;
+				archetypes.reserve(m_archetypes.size());
+				for (auto& a : m_archetypes)
+				{
+					if (freed(a.get()))
+						continue;
+					a->m_edges.erase(std::remove_if(a->m_edges.begin(), a->m_edges.end(), [&freed](const auto& edge) {
+						return freed(edge.second);
+					}), a->m_edges.end());
+					archetypes.push_back(std::move(a));
+				}
+				m_archetypes = std::move(archetypes);
+				for (std::size_t i = 0; i < m_archetypes.size(); ++i)
+				{
+					archetype* a = m_archetypes[i].get();
+					if (a->m_id == i)
+						continue;
+					a->m_id = i;
+					for (entity e : a->m_entities)
+						m_entity_index[e] = i;
+				}
+				refresh_groups();
+			}
+
+			// group-owned columns live in their group's arena and are repacked by it
+			for (auto& a : m_archetypes)
+			{
+				if (!a->get_group() && a->m_entities.size() < a->m_entities.capacity() * policy.m_shrink_ratio)
+					a->shrink_to_fit();
+			}
+
+			if (policy.m_trim_entity_index)
+			{
+				std::size_t size = m_entity_index.size();
+				while (size && m_entity_index[size - 1] == invalid_index)
+					--size;
+				if (size != m_entity_index.size())
+				{
+					m_trimmed_size = std::max(m_trimmed_size, m_entity_index.size());
+					m_trim_tick = m_tick;
+					destroyed_entities.erase(std::remove_if(destroyed_entities.begin(), destroyed_entities.end(), [size](entity e) {
+						return e >= size;
+					}), destroyed_entities.end());
+					m_entity_index.resize(size);
+					m_entity_ticks.resize(size);
+				}
+				if (m_entity_index.size() < m_entity_index.capacity() * policy.m_shrink_ratio)
+				{
+					m_entity_index.shrink_to_fit();
+					m_entity_ticks.shrink_to_fit();
+					destroyed_entities.shrink_to_fit();
+				}
+			}
+		}
+
 		std::vector<entity> get_orphan_entities() const
 		{
 			std::vector<std::size_t> entities;
@@ -0,0 +1,207 @@
+#ifndef APOLLO_SHARDED_REGISTRY_H
+#define APOLLO_SHARDED_REGISTRY_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include "registry.h"
+
+namespace apollo
+{
+	struct entity_location
+	{
+		std::size_t m_shard = invalid_index;
+		entity m_entity = invalid_index;
+	};
+
+	// Several registries sharing one global entity id space. Each shard runs on
+	// its own thread pool and only its owner may change it structurally;
+	// migrations are queued by the owner and applied in batches by sync(), which
+	// must be called while no shard is running. Global ids stay valid across
+	// migrations, local ids do not.
+	class sharded_registry
+	{
+	public:
+		static constexpr std::size_t block_size = 1024;
+	private:
+		struct shard
+		{
+			std::unique_ptr<registry> m_registry;
+			std::vector<entity> m_globals;
+			std::vector<entity> m_free;
+			entity m_next = 0;
+			entity m_end = 0;
+			std::vector<std::pair<entity, std::size_t>> m_outbox;
+		};
+
+		std::vector<shard> m_shards;
+		// one page per block of global ids, owned by the shard that allocated it
+		std::vector<std::unique_ptr<entity_location[]>> m_pages;
+		std::atomic<std::size_t> m_next_page{ 0 };
+	private:
+		inline entity_location& location(const entity global)
+		{
+			return m_pages[global / block_size][global % block_size];
+		}
+
+		inline const entity_location& location(const entity global) const
+		{
+			return m_pages[global / block_size][global % block_size];
+		}
+	public:
+		explicit sharded_registry(const std::size_t num_shards, const std::size_t threads_per_shard = 1, const std::size_t max_entities = 1 << 24, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: m_shards(num_shards), m_pages((max_entities + block_size - 1) / block_size)
+		{
+			for (auto& s : m_shards)
+				s.m_registry = std::make_unique<registry>(threads_per_shard, resource);
+		}
+
+		inline std::size_t size() const
+		{
+			return m_shards.size();
+		}
+
+		inline registry& get_shard(const std::size_t index)
+		{
+			return *m_shards[index].m_registry;
+		}
+
+		// Returns invalid_index once max_entities ids have been handed out.
+		entity create(const std::size_t index)
+		{
+			shard& s = m_shards[index];
+			entity global;
+			if (!s.m_free.empty())
+			{
+				global = s.m_free.back();
+				s.m_free.pop_back();
+			}
+			else
+			{
+				if (s.m_next == s.m_end)
+				{
+					const std::size_t page = m_next_page.fetch_add(1, std::memory_order_relaxed);
+					if (page >= m_pages.size())
+						return invalid_index;
+					m_pages[page] = std::make_unique<entity_location[]>(block_size);
+					s.m_next = page * block_size;
+					s.m_end = s.m_next + block_size;
+				}
+				global = s.m_next++;
+			}
+			const entity local = s.m_registry->create();
+			if (s.m_globals.size() <= local)
+				s.m_globals.resize(local + 1, invalid_index);
+			s.m_globals[local] = global;
+			location(global) = { index, local };
+			return global;
+		}
+
+		void destroy(const entity global)
+		{
+			entity_location& l = location(global);
+			shard& s = m_shards[l.m_shard];
+			entity local = l.m_entity;
+			s.m_registry->destroy(local);
+			s.m_globals[l.m_entity] = invalid_index;
+			s.m_free.push_back(global);
+			l = {};
+		}
+
+		inline entity_location locate(const entity global) const
+		{
+			return location(global);
+		}
+
+		inline entity get_global(const std::size_t index, const entity local) const
+		{
+			return m_shards[index].m_globals[local];
+		}
+
+		// Queues global to move to shard target at the next sync(). Called by
+		// the owner of the shard global currently lives in.
+		void migrate(const entity global, const std::size_t target)
+		{
+			const entity_location& l = location(global);
+			if (l.m_shard != target)
+				m_shards[l.m_shard].m_outbox.emplace_back(global, target);
+		}
+
+		// Runs fn(registry&, shard index) for every shard on that shard's own pool and waits.
+		template <typename Fn>
+		void parallel(Fn&& fn)
+		{
+			std::vector<job> jobs;
+			jobs.reserve(m_shards.size());
+			for (std::size_t i = 0; i < m_shards.size(); ++i)
+			{
+				registry* r = m_shards[i].m_registry.get();
+				jobs.push_back(r->create_job([&fn, r, i]() {
+					fn(*r, i);
+				}));
+			}
+			std::vector<job_handle> handles;
+			handles.reserve(jobs.size());
+			for (auto& j : jobs)
+				handles.push_back(j.schedule());
+			for (auto& handle : handles)
+				handle.complete();
+		}
+
+		// Applies all queued migrations, one batch per shard pair. Returns how many entities moved.
+		std::size_t sync()
+		{
+			std::size_t moved = 0;
+			std::vector<entity> locals;
+			std::vector<entity> globals;
+			std::vector<entity> migrated;
+			for (std::size_t from = 0; from < m_shards.size(); ++from)
+			{
+				shard& source = m_shards[from];
+				auto& outbox = source.m_outbox;
+				std::sort(outbox.begin(), outbox.end(), [](const auto& lhs, const auto& rhs) {
+					return lhs.second < rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+				});
+				outbox.erase(std::unique(outbox.begin(), outbox.end()), outbox.end());
+				for (std::size_t begin = 0; begin < outbox.size();)
+				{
+					const std::size_t to = outbox[begin].second;
+					locals.clear();
+					globals.clear();
+					for (; begin < outbox.size() && outbox[begin].second == to; ++begin)
+					{
+						// an entity queued for several shards goes to the lowest one
+						const entity_location& l = location(outbox[begin].first);
+						if (l.m_shard != from)
+							continue;
+						locals.push_back(l.m_entity);
+						globals.push_back(outbox[begin].first);
+					}
+					if (locals.empty())
+						continue;
+					shard& target = m_shards[to];
+					source.m_registry->migrate(locals, *target.m_registry, migrated);
+					for (std::size_t i = 0; i < migrated.size(); ++i)
+					{
+						// destroyed through the shard after it was queued
+						if (migrated[i] == invalid_index)
+							continue;
+						source.m_globals[locals[i]] = invalid_index;
+						if (target.m_globals.size() <= migrated[i])
+							target.m_globals.resize(migrated[i] + 1, invalid_index);
+						target.m_globals[migrated[i]] = globals[i];
+						location(globals[i]) = { to, migrated[i] };
+						++moved;
+					}
+				}
+				outbox.clear();
+			}
+			return moved;
+		}
+	};
+}
+
+#endif // !APOLLO_SHARDED_REGISTRY_H
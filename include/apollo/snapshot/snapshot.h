@@ -0,0 +1,139 @@
+#ifndef APOLLO_SNAPSHOT_SNAPSHOT_H
+#define APOLLO_SNAPSHOT_SNAPSHOT_H
+
+#include "../core/common.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace apollo
+{
+	// Snapshots and deltas are raw, native-endian images of the registry meant
+	// to be restored on the same platform. Columns are keyed by component type
+	// hash, so files stay valid across builds while names and layouts do.
+	constexpr std::uint32_t snapshot_magic = 0x4e535041; // "APSN"
+	constexpr std::uint32_t delta_magic = 0x4c445041; // "APDL"
+	constexpr std::uint32_t snapshot_version = 3;
+
+	class snapshot_writer
+	{
+	private:
+		std::ofstream m_stream;
+		std::vector<std::byte>* m_buffer = nullptr;
+	public:
+		explicit snapshot_writer(const std::string& path)
+			: m_stream(path, std::ios::binary | std::ios::trunc)
+		{
+		}
+
+		explicit snapshot_writer(std::vector<std::byte>& buffer)
+			: m_buffer(&buffer)
+		{
+		}
+
+		inline bool good() const
+		{
+			return m_buffer || m_stream.good();
+		}
+
+		template <typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "type parameter T must be trivially copyable");
+			write_bytes(&value, sizeof(T));
+		}
+
+		void write_bytes(const void* data, const std::size_t size)
+		{
+			if (!size)
+				return;
+			if (m_buffer)
+			{
+				const std::byte* bytes = static_cast<const std::byte*>(data);
+				m_buffer->insert(m_buffer->end(), bytes, bytes + size);
+			}
+			else
+			{
+				m_stream.write(static_cast<const char*>(data), size);
+			}
+		}
+
+		template <typename T, typename Allocator>
+		void write_vector(const std::vector<T, Allocator>& values)
+		{
+			write<std::uint64_t>(values.size());
+			write_bytes(values.data(), values.size() * sizeof(T));
+		}
+
+		bool flush()
+		{
+			if (m_buffer)
+				return true;
+			m_stream.flush();
+			return m_stream.good();
+		}
+	};
+
+	class snapshot_reader
+	{
+	private:
+		const std::byte* m_data;
+		std::size_t m_size;
+		std::size_t m_offset = 0;
+		bool m_good = true;
+	public:
+		snapshot_reader(const std::byte* data, const std::size_t size)
+			: m_data(data), m_size(size)
+		{
+		}
+
+		inline bool good() const
+		{
+			return m_good;
+		}
+
+		template <typename T>
+		T read()
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "type parameter T must be trivially copyable");
+			T value{};
+			const std::byte* bytes = read_bytes(sizeof(T));
+			if (bytes)
+				std::memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		const std::byte* read_bytes(const std::size_t size)
+		{
+			if (!m_good || size > m_size - m_offset)
+			{
+				m_good = false;
+				return nullptr;
+			}
+			const std::byte* bytes = m_data + m_offset;
+			m_offset += size;
+			return bytes;
+		}
+
+		template <typename T>
+		bool read_vector(std::vector<T>& values)
+		{
+			const std::size_t count = static_cast<std::size_t>(read<std::uint64_t>());
+			if (!m_good || count > (m_size - m_offset) / sizeof(T))
+			{
+				m_good = false;
+				return false;
+			}
+			values.resize(count);
+			const std::byte* bytes = read_bytes(count * sizeof(T));
+			if (count)
+				std::memcpy(values.data(), bytes, count * sizeof(T));
+			return true;
+		}
+	};
+}
+
+#endif // !APOLLO_SNAPSHOT_SNAPSHOT_H
@@ -0,0 +1,105 @@
+#ifndef APOLLO_SOA_H
+#define APOLLO_SOA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "core/span.h"
+
+namespace apollo
+{
+	template <typename T>
+	struct member_pointer_traits;
+
+	template <typename ClassType, typename MemberType>
+	struct member_pointer_traits<MemberType ClassType::*>
+	{
+		using class_type = ClassType;
+		using member_type = MemberType;
+	};
+
+	template <auto Field, auto First, auto... Rest>
+	constexpr std::size_t field_index()
+	{
+		if constexpr (std::is_same<decltype(Field), decltype(First)>::value)
+		{
+			if (Field == First)
+				return 0;
+		}
+		if constexpr (sizeof...(Rest) == 0)
+			return 1;
+		else
+			return 1 + field_index<Field, Rest...>();
+	}
+
+	template <auto... Fields>
+	struct soa_fields
+	{
+		using columns = std::tuple<std::pmr::vector<typename member_pointer_traits<decltype(Fields)>::member_type>...>;
+
+		static constexpr std::size_t size = sizeof...(Fields);
+
+		static constexpr auto members = std::make_tuple(Fields...);
+
+		template <auto Field>
+		static constexpr std::size_t index = field_index<Field, Fields...>();
+	};
+
+	// Specialize to store a component as one column per field:
+	// template <> struct apollo::soa_layout<transform> : apollo::soa_fields<&transform::m_x, &transform::m_y, &transform::m_z> {};
+	template <typename Component>
+	struct soa_layout
+	{
+	};
+
+	template <typename Component, typename = void>
+	struct is_soa : std::false_type
+	{
+	};
+
+	template <typename Component>
+	struct is_soa<Component, std::void_t<typename soa_layout<Component>::columns>> : std::true_type
+	{
+	};
+
+	template <typename Component>
+	class soa_ref;
+
+	template <typename Component>
+	class soa_span;
+
+	template <typename T>
+	struct component_type
+	{
+		using type = T;
+	};
+
+	template <typename Component>
+	struct component_type<soa_ref<Component>>
+	{
+		using type = Component;
+	};
+
+	template <typename Component>
+	struct component_type<soa_span<Component>>
+	{
+		using type = Component;
+	};
+
+	template <typename Component>
+	struct component_type<span<Component>>
+	{
+		using type = std::remove_const_t<Component>;
+	};
+
+	// Maps a query argument (transform&, const transform&, soa_ref<transform>, span<const transform>) to its component.
+	template <typename Arg>
+	using component_type_t = typename component_type<std::decay_t<Arg>>::type;
+
+	template <typename Component>
+	using component_reference_t = std::conditional_t<is_soa<Component>::value, soa_ref<Component>, Component&>;
+}
+
+#endif // !APOLLO_SOA_H
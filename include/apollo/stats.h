@@ -0,0 +1,86 @@
+#ifndef APOLLO_STATS_H
+#define APOLLO_STATS_H
+
+#include "core/common.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace apollo
+{
+	// Compiles to nothing unless APOLLO_ENABLE_STATS is defined.
+	class stat_counter
+	{
+	private:
+#ifdef APOLLO_ENABLE_STATS
+		std::atomic<std::uint64_t> m_value{ 0 };
+#endif
+	public:
+		inline void increment(const std::uint64_t n = 1)
+		{
+#ifdef APOLLO_ENABLE_STATS
+			m_value.fetch_add(n, std::memory_order_relaxed);
+#else
+			(void)n;
+#endif
+		}
+
+		inline std::uint64_t get() const
+		{
+#ifdef APOLLO_ENABLE_STATS
+			return m_value.load(std::memory_order_relaxed);
+#else
+			return 0;
+#endif
+		}
+
+		inline void reset()
+		{
+#ifdef APOLLO_ENABLE_STATS
+			m_value.store(0, std::memory_order_relaxed);
+#endif
+		}
+	};
+
+	struct registry_counters
+	{
+		stat_counter m_archetype_moves;
+		stat_counter m_observer_notifications;
+		stat_counter m_query_matches;
+		stat_counter m_entity_recycles;
+	};
+
+	struct column_stats
+	{
+		id_type m_component_id;
+		std::size_t m_size_bytes;
+		std::size_t m_capacity_bytes;
+	};
+
+	struct archetype_stats
+	{
+		id_type m_id;
+		std::size_t m_num_entities;
+		std::size_t m_entity_capacity;
+		std::vector<column_stats> m_columns;
+		std::size_t m_edges;
+		std::size_t m_edge_capacity;
+		std::size_t m_size_bytes;
+		std::size_t m_capacity_bytes;
+	};
+
+	struct registry_stats
+	{
+		std::vector<archetype_stats> m_archetypes;
+		std::size_t m_num_entities = 0;
+		std::size_t m_num_recyclable = 0;
+		std::size_t m_size_bytes = 0;
+		std::size_t m_capacity_bytes = 0;
+		std::uint64_t m_archetype_moves = 0;
+		std::uint64_t m_observer_notifications = 0;
+		std::uint64_t m_query_matches = 0;
+		std::uint64_t m_entity_recycles = 0;
+	};
+}
+
+#endif // !APOLLO_STATS_H
@@ -3,8 +3,6 @@
 
 #include "job/job.h"
 #include "job/job_handle.h"
-#include <iostream>
-#include <sstream>
 
 namespace apollo
 {
@@ -12,9 +10,8 @@ namespace apollo
 
 	class system
 	{
-	private:
-		registry& m_registry;
 	protected:
+		registry& m_registry;
 		job m_dependency;
 	protected:
 		system(registry& registry)
@@ -23,18 +20,27 @@ namespace apollo
 		template <typename Fn>
 		job& for_each(Fn&& query)
 		{
-			std::stringstream s1;
-			s1 << " waiting for " << m_dependency.m_id << "\n";
 			m_dependency = m_registry.for_each(query, m_dependency);
-			std::stringstream s2;
-			s2 << m_dependency.m_id << s1.str();
-			std::cout << s2.str();
 			return m_dependency;
 		}
 	public:
-		~system() = default;
+		virtual ~system() = default;
 
 		virtual void update() = 0;
+
+		// Waits for the last job scheduled through for_each.
+		void complete()
+		{
+			if (m_dependency.m_handle.valid())
+				m_dependency.m_handle.complete();
+		}
+
+		// Waits for everything the system still has in flight; the registry calls it
+		// on every system before destroying any.
+		virtual void finish()
+		{
+			complete();
+		}
 	};
 }
 
@@ -0,0 +1,212 @@
+#ifndef APOLLO_VIEW_H
+#define APOLLO_VIEW_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "archetype.h"
+#include "soa.h"
+
+namespace apollo
+{
+	// What a view yields for Component: a reference, or for const Components a const
+	// reference, SoA components by value since their fields are not stored together.
+	template <typename Component>
+	using view_reference_t = std::conditional_t<std::is_const<Component>::value,
+		std::conditional_t<is_soa<std::remove_const_t<Component>>::value, std::remove_const_t<Component>, Component&>,
+		component_reference_t<Component>>;
+
+	// Lazy range over the entities holding all of Components, walking matching
+	// resident archetypes and their rows in place. Dereferencing yields a tuple of the
+	// entity and references to its components, so structured bindings work.
+	// Like a query taking them mutably, rows are stamped with the view's tick as
+	// iterators reach them unless every component is const.
+	// Nothing is allocated; like container iterators, views and their iterators
+	// are invalidated by structural changes.
+	template <typename... Components>
+	class view
+	{
+		static_assert(((std::is_base_of<component<std::remove_const_t<Components>>, std::remove_const_t<Components>>::value) && ...), "type parameters of view must derive from component");
+		static constexpr bool stamps = ((!std::is_const<Components>::value) || ...);
+	public:
+		using value_type = std::tuple<entity, view_reference_t<Components>...>;
+
+		class iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = typename view::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
+		private:
+			const archetype_ptr* m_archetype = nullptr;
+			const archetype_ptr* m_last = nullptr;
+			std::size_t m_row = 0;
+			// rows left before the end of the view
+			std::size_t m_remaining = 0;
+			const entity* m_entities = nullptr;
+			std::tuple<decltype(std::declval<archetype&>().template get_column<std::remove_const_t<Components>>())...> m_columns;
+			std::uint64_t m_tick = 0;
+		private:
+			void load()
+			{
+				archetype& current = **m_archetype;
+				m_entities = current.get_entities().data();
+				m_columns = std::make_tuple(current.template get_column<std::remove_const_t<Components>>()...);
+				if constexpr (stamps)
+					current.set_versions(m_row, std::min(current.get_entities().size() - m_row, m_remaining), m_tick);
+			}
+
+			// Moves to the first matching archetype with a row at or after m_row.
+			void settle()
+			{
+				if (!m_remaining)
+					return;
+				for (; m_archetype != m_last; ++m_archetype)
+				{
+					if ((*m_archetype)->is_cold() || !(*m_archetype)->template has_all<std::remove_const_t<Components>...>())
+						continue;
+					const std::size_t size = (*m_archetype)->get_entities().size();
+					if (m_row < size)
+						break;
+					m_row -= size;
+				}
+				if (m_archetype != m_last)
+					load();
+			}
+		public:
+			iterator() = default;
+
+			iterator(const archetype_ptr* first, const archetype_ptr* last, const std::size_t offset, const std::size_t count, const std::uint64_t tick)
+				: m_archetype(first), m_last(last), m_row(offset), m_remaining(count), m_tick(tick)
+			{
+				settle();
+			}
+
+			value_type operator*() const
+			{
+				return std::apply([this](auto... columns) {
+					return value_type(m_entities[m_row], archetype::column_at(columns, m_row)...);
+				}, m_columns);
+			}
+
+			iterator& operator++()
+			{
+				if (--m_remaining && ++m_row >= (*m_archetype)->get_entities().size())
+				{
+					m_row = 0;
+					++m_archetype;
+					settle();
+				}
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator result = *this;
+				++(*this);
+				return result;
+			}
+
+			// Skips whole archetypes, O(archetypes) rather than O(n).
+			iterator& operator+=(const std::size_t n)
+			{
+				if (n >= m_remaining)
+				{
+					m_remaining = 0;
+					return *this;
+				}
+				m_remaining -= n;
+				m_row += n;
+				settle();
+				return *this;
+			}
+
+			iterator operator+(const std::size_t n) const
+			{
+				iterator result = *this;
+				return result += n;
+			}
+
+			difference_type operator-(const iterator& other) const
+			{
+				return static_cast<difference_type>(other.m_remaining) - static_cast<difference_type>(m_remaining);
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_remaining == other.m_remaining;
+			}
+
+			bool operator!=(const iterator& other) const
+			{
+				return m_remaining != other.m_remaining;
+			}
+		};
+	private:
+		const archetype_ptr* m_first = nullptr;
+		const archetype_ptr* m_last = nullptr;
+		std::size_t m_offset = 0;
+		std::size_t m_count = invalid_index;
+		std::uint64_t m_tick = 0;
+	public:
+		view() = default;
+
+		view(const archetype_ptr* first, const archetype_ptr* last, const std::uint64_t tick = 0)
+			: m_first(first), m_last(last), m_tick(tick)
+		{
+		}
+
+		// Number of rows in the view, counted over the matching archetypes.
+		std::size_t size_hint() const
+		{
+			if (m_count != invalid_index)
+				return m_count;
+			std::size_t size = 0;
+			for (const archetype_ptr* it = m_first; it != m_last; ++it)
+			{
+				if (!(*it)->is_cold() && (*it)->template has_all<std::remove_const_t<Components>...>())
+					size += (*it)->get_entities().size();
+			}
+			return size;
+		}
+
+		inline bool empty() const
+		{
+			return begin() == end();
+		}
+
+		iterator begin() const
+		{
+			return iterator(m_first, m_last, m_offset, size_hint(), m_tick);
+		}
+
+		iterator end() const
+		{
+			return iterator();
+		}
+
+		// Rows [first, last) of this view, for handing disjoint parts to workers.
+		view subview(const std::size_t first, const std::size_t last) const
+		{
+			const std::size_t size = size_hint();
+			view result = *this;
+			result.m_offset = m_offset + std::min(first, size);
+			result.m_count = std::min(last, size) - std::min(first, std::min(last, size));
+			return result;
+		}
+
+		// The index-th of parts contiguous parts of near equal size.
+		view split(const std::size_t parts, const std::size_t index) const
+		{
+			const std::size_t size = size_hint();
+			return subview(size * index / parts, size * (index + 1) / parts);
+		}
+	};
+}
+
+#endif // !APOLLO_VIEW_H
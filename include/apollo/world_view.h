@@ -0,0 +1,87 @@
+#ifndef APOLLO_WORLD_VIEW_H
+#define APOLLO_WORLD_VIEW_H
+
+#include "core/common.h"
+#include "core/type_traits.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace apollo
+{
+	constexpr std::size_t world_view_chunk_size = 1024;
+
+	// An immutable copy of the registry columns taken at a frame boundary.
+	// Chunks that did not change since the previous view are shared with it.
+	class world_view
+	{
+	private:
+		struct column
+		{
+			id_type m_id;
+			std::vector<std::shared_ptr<const void>> m_chunks;
+		};
+
+		struct archetype_view
+		{
+			std::vector<id_type> m_signature;
+			std::vector<std::shared_ptr<const std::vector<entity>>> m_entities;
+			std::vector<column> m_columns;
+			std::size_t m_size = 0;
+
+			template<typename Component>
+			const column* get_column() const
+			{
+				auto it = std::find_if(m_columns.begin(), m_columns.end(), [](const column& c) {
+					return c.m_id == Component::id;
+				});
+				return it != m_columns.end() ? &*it : nullptr;
+			}
+		};
+
+		std::vector<archetype_view> m_archetypes;
+		std::uint64_t m_tick = 0;
+	private:
+		template<typename Fn, typename ClassType, typename ReturnType, typename Entity, typename... Args>
+		void apply_to_archetype_view(const archetype_view& archetype, Fn& func, function_traits<ReturnType(ClassType::*)(Entity, Args...)const>) const
+		{
+			static_assert(((std::is_const<std::remove_reference_t<Args>>::value) && ...), "world view components must be taken by const reference");
+			if (((archetype.get_column<std::decay_t<Args>>() == nullptr) || ...))
+				return;
+			for (std::size_t c = 0; c < archetype.m_entities.size(); ++c)
+			{
+				const std::vector<entity>& entities = *archetype.m_entities[c];
+				std::tuple<const std::vector<std::decay_t<Args>>&...> chunks{
+					*static_cast<const std::vector<std::decay_t<Args>>*>(archetype.get_column<std::decay_t<Args>>()->m_chunks[c].get())... };
+				for (std::size_t i = 0; i < entities.size(); ++i)
+				{
+					std::apply([&](auto&... vecs) {
+						func(entities[i], vecs[i]...);
+					}, chunks);
+				}
+			}
+		}
+	public:
+		inline std::uint64_t tick() const
+		{
+			return m_tick;
+		}
+
+		template <typename Fn>
+		void for_each(Fn&& fn) const
+		{
+			typedef function_traits<decltype(fn)> traits;
+			for (const auto& archetype : m_archetypes)
+			{
+				if (archetype.m_size)
+					apply_to_archetype_view(archetype, fn, typename traits::self());
+			}
+		}
+
+		friend class registry;
+	};
+}
+
+#endif // !APOLLO_WORLD_VIEW_H
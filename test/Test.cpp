@@ -1,10 +1,19 @@
 #include <gtest/gtest.h>
+#include <filesystem>
 #include <iostream>
+#include <memory_resource>
+#include <sstream>
 #include <apollo/apollo.h>
+#include <apollo/command/destroy_command.h>
+#include <apollo/command/remove_command.h>
+#include <apollo/memory/huge_page_resource.h>
+#include <apollo/memory/world_arena.h>
 #include "transform.h"
 #include "mass.h"
 #include "velocity.h"
+#include "position.h"
 #include "move_system.h"
+#include "phased_system.h"
 
 TEST(Test, Test1)
 {
@@ -60,3 +69,1319 @@ TEST(Test, Test1)
 	registry.on_destroy<mass>().disconnect(callback_id2);
 	registry.on_update<transform>().disconnect(callback_id3);
 }
+
+TEST(Test, Snapshot)
+{
+	apollo::registry registry;
+
+	apollo::entity e1 = registry.create();
+	apollo::entity e2 = registry.create();
+	apollo::entity e3 = registry.create();
+
+	registry.emplace<transform>(e1, 10.0f, 50.0f, 30.0f);
+	registry.emplace<mass>(e1, 15.0f);
+	registry.emplace<transform>(e2, 1.0f, 2.0f, 3.0f);
+	registry.destroy(e3);
+
+	const std::string path = (std::filesystem::temp_directory_path() / "apollo_snapshot.bin").string();
+	ASSERT_TRUE(registry.save(path));
+
+	// a rejected save leaves the previous snapshot intact
+	apollo::registry soa;
+	soa.emplace<position>(soa.create(), 1.0f, 2.0f);
+	EXPECT_FALSE(soa.save(path));
+
+	apollo::registry restored;
+	ASSERT_TRUE((restored.load<transform, mass>(path)));
+
+	auto c1 = restored.try_get<transform, mass>(e1);
+	ASSERT_TRUE(c1.has_value());
+	EXPECT_EQ(std::get<0>(*c1).m_y, 50.0f);
+	EXPECT_EQ(std::get<1>(*c1).m_mass, 15.0f);
+	EXPECT_TRUE(restored.has<transform>(e2));
+	EXPECT_FALSE(restored.has<mass>(e2));
+	EXPECT_EQ(restored.create(), e3);
+
+	apollo::registry missing_types;
+	EXPECT_FALSE(missing_types.load<transform>(path));
+	std::filesystem::remove(path);
+}
+
+TEST(Test, Delta)
+{
+	apollo::registry source;
+	apollo::registry replica;
+
+	apollo::entity e1 = source.create();
+	apollo::entity e2 = source.create();
+	source.emplace<transform>(e1, 1.0f, 1.0f, 1.0f);
+	source.emplace<transform>(e2, 2.0f, 2.0f, 2.0f);
+	source.emplace<mass>(e2, 3.0f);
+
+	std::vector<std::byte> full;
+	ASSERT_TRUE(source.save_delta(full, 0));
+	ASSERT_TRUE((replica.apply_delta<transform, mass>(full)));
+
+	source.update();
+	const std::uint64_t since = source.tick();
+	source.replace<transform>(e1, 5.0f, 5.0f, 5.0f);
+	source.remove<mass>(e2);
+
+	std::vector<std::byte> delta;
+	ASSERT_TRUE(source.save_delta(delta, since));
+	ASSERT_TRUE((replica.apply_delta<transform, mass>(delta)));
+
+	auto t1 = replica.try_get<transform, transform>(e1);
+	ASSERT_TRUE(t1.has_value());
+	EXPECT_EQ(std::get<0>(*t1).m_x, 5.0f);
+	EXPECT_TRUE(replica.has<transform>(e2));
+	EXPECT_FALSE(replica.has<mass>(e2));
+
+	// a delta that cannot be written leaves the buffer as it was
+	apollo::entity e3 = source.create();
+	source.emplace<position>(e3, 1.0f, 2.0f);
+	const std::vector<std::byte> before = delta;
+	EXPECT_FALSE(source.save_delta(delta, since));
+	EXPECT_EQ(delta, before);
+}
+
+TEST(Test, WorldView)
+{
+	apollo::registry registry(1);
+	for (int i = 0; i < 3000; ++i)
+		registry.emplace<mass>(registry.create(), static_cast<float>(i));
+	EXPECT_EQ(registry.get_world_view(), nullptr);
+
+	auto first = registry.publish_world_view();
+	registry.update();
+	apollo::entity patched = 5;
+	apollo::entity destroyed = 2999;
+	registry.patch(patched, [](mass& m) {
+		m.m_mass = -1.0f;
+	});
+	registry.destroy(destroyed);
+	auto second = registry.publish_world_view();
+	EXPECT_EQ(registry.get_world_view(), second);
+	EXPECT_EQ(second->tick(), first->tick() + 1);
+
+	// readers of the first view keep seeing the frame it was taken at
+	auto lookup = [](const apollo::world_view& view, apollo::entity entity, float& found, std::size_t& count) {
+		view.for_each([entity, &found, &count](const apollo::entity& e, const mass& m) {
+			if (e == entity)
+				found = m.m_mass;
+			++count;
+		});
+	};
+	float value = 0.0f;
+	std::size_t count = 0;
+	lookup(*first, 5, value, count);
+	EXPECT_EQ(value, 5.0f);
+	EXPECT_EQ(count, 3000u);
+	count = 0;
+	lookup(*second, 5, value, count);
+	EXPECT_EQ(value, -1.0f);
+	EXPECT_EQ(count, 2999u);
+}
+
+TEST(Test, Trace)
+{
+	apollo::tracer& tracer = apollo::tracer::instance();
+	tracer.clear();
+	tracer.record("say \"hi\"\\\n", "system", 1000, 3000);
+	std::ostringstream out;
+	tracer.export_chrome_trace(out);
+	const std::string json = out.str();
+	EXPECT_NE(json.find("{\"name\":\"say \\\"hi\\\"\\\\\\u000a\",\"cat\":\"system\",\"ph\":\"X\""), std::string::npos);
+	EXPECT_NE(json.find("\"ts\":1,\"dur\":2}"), std::string::npos);
+
+#if defined(__GNUG__)
+	EXPECT_STREQ(apollo::trace_type_name(typeid(apollo::registry)), "apollo::registry");
+#endif
+	EXPECT_EQ(apollo::trace_type_name(typeid(apollo::registry)), apollo::trace_type_name(typeid(apollo::registry)));
+	tracer.clear();
+}
+
+TEST(Test, Stats)
+{
+	apollo::registry registry(1);
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+		if (i % 2 == 0)
+			registry.emplace<mass>(e, 1.0f);
+	}
+	apollo::entity destroyed = 3;
+	registry.destroy(destroyed);
+
+	const apollo::registry_stats stats = registry.stats();
+	EXPECT_EQ(stats.m_num_entities, 99u);
+	EXPECT_EQ(stats.m_num_recyclable, 1u);
+	EXPECT_EQ(stats.m_archetypes.size(), 3u);
+	EXPECT_GE(stats.m_capacity_bytes, stats.m_size_bytes);
+	std::size_t size_bytes = 0;
+	for (const auto& a : stats.m_archetypes)
+	{
+		size_bytes += a.m_size_bytes;
+		if (a.m_columns.size() == 2)
+		{
+			EXPECT_EQ(a.m_num_entities, 50u);
+			EXPECT_EQ(a.m_size_bytes, 50 * (sizeof(apollo::entity) + sizeof(std::uint64_t) + sizeof(transform) + sizeof(mass)));
+		}
+	}
+	EXPECT_EQ(size_bytes, stats.m_size_bytes);
+
+#ifdef APOLLO_ENABLE_STATS
+	// the first transform moves an entity out of the empty archetype, the mass a second time
+	EXPECT_EQ(stats.m_archetype_moves, 150u);
+	registry.reset_stats();
+	EXPECT_EQ(registry.stats().m_archetype_moves, 0u);
+#else
+	EXPECT_EQ(stats.m_archetype_moves, 0u);
+#endif
+}
+
+TEST(Test, Compact)
+{
+	apollo::registry source(1);
+	apollo::registry replica(1);
+	std::vector<apollo::entity> entities;
+	for (int i = 0; i < 64; ++i)
+	{
+		apollo::entity e = source.create();
+		source.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i >= 32)
+			source.emplace<mass>(e, 1.0f);
+		entities.push_back(e);
+	}
+	std::vector<std::byte> full;
+	ASSERT_TRUE(source.save_delta(full, 0));
+	ASSERT_TRUE((replica.apply_delta<transform, mass>(full)));
+
+	source.update();
+	const std::uint64_t since = source.tick();
+	for (int i = 32; i < 64; ++i)
+		source.destroy(entities[i]);
+	const std::size_t archetypes = source.stats().m_archetypes.size();
+	source.compact();
+	const apollo::registry_stats stats = source.stats();
+	EXPECT_EQ(stats.m_archetypes.size(), archetypes - 1);
+	EXPECT_EQ(stats.m_num_entities, 32u);
+	EXPECT_EQ(stats.m_num_recyclable, 0u);
+	for (int i = 0; i < 32; ++i)
+		EXPECT_EQ((std::get<0>(source.get<transform, transform>(entities[i])).m_x), static_cast<float>(i));
+
+	// the destroys of trimmed ids still reach a replica syncing across the compaction
+	std::vector<std::byte> delta;
+	ASSERT_TRUE(source.save_delta(delta, since));
+	ASSERT_TRUE((replica.apply_delta<transform, mass>(delta)));
+	for (int i = 0; i < 64; ++i)
+		EXPECT_EQ(replica.valid(entities[i]), i < 32);
+
+	// group-owned columns are left in their arena
+	apollo::registry grouped(1);
+	for (int i = 0; i < 64; ++i)
+		grouped.emplace<transform>(grouped.create(), static_cast<float>(i), 0.0f, 0.0f);
+	grouped.group<transform>();
+	for (apollo::entity e = 16; e < 64; ++e)
+		grouped.destroy(e);
+	const transform* column = &std::get<0>(grouped.get<transform, transform>(0));
+	grouped.compact();
+	EXPECT_EQ(&std::get<0>(grouped.get<transform, transform>(0)), column);
+	EXPECT_EQ((std::get<0>(grouped.get<transform, transform>(15)).m_x), 15.0f);
+}
+
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+	std::size_t m_allocations = 0;
+	std::size_t m_live_bytes = 0;
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		++m_allocations;
+		m_live_bytes += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+	{
+		m_live_bytes -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+TEST(Test, MemoryResource)
+{
+	counting_resource resource;
+	counting_resource fallback;
+	std::pmr::memory_resource* previous = std::pmr::set_default_resource(&fallback);
+	{
+		apollo::registry registry(1, &resource);
+		for (int i = 0; i < 1000; ++i)
+		{
+			apollo::entity e = registry.create();
+			registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+			if (i % 2)
+				registry.emplace<mass>(e, 1.0f);
+		}
+		registry.group<transform, mass>();
+		EXPECT_GT(resource.m_allocations, 0u);
+		EXPECT_GE(resource.m_live_bytes, 1000 * sizeof(transform));
+		EXPECT_EQ((std::get<0>(registry.get<transform, transform>(999)).m_x), 999.0f);
+	}
+	std::pmr::set_default_resource(previous);
+	// everything went through the registry's resource and came back to it
+	EXPECT_EQ(resource.m_live_bytes, 0u);
+	EXPECT_EQ(fallback.m_allocations, 0u);
+
+	apollo::huge_page_resource huge_pages(1 << 16, &resource);
+	apollo::world_arena arena(1 << 16, &huge_pages);
+	{
+		apollo::registry registry(1, &arena);
+		for (int i = 0; i < 100000; ++i)
+			registry.emplace<transform>(registry.create(), static_cast<float>(i), 0.0f, 0.0f);
+		float sum = 0.0f;
+		for (auto [e, t] : registry.view<transform>())
+			sum += t.m_x - static_cast<float>(e);
+		EXPECT_EQ(sum, 0.0f);
+	}
+	arena.release();
+	EXPECT_EQ(resource.m_live_bytes, 0u);
+}
+
+TEST(Test, SoA)
+{
+	apollo::registry registry(2);
+
+	std::vector<apollo::entity> entities;
+	for (int i = 0; i < 8; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<position>(e, static_cast<float>(i), 0.0f);
+		registry.emplace<velocity>(e, 2.0f);
+		entities.push_back(e);
+	}
+
+	apollo::job dependency;
+	registry.for_each([](apollo::entity&, apollo::soa_ref<position> p, const velocity& v) {
+		p.get<&position::m_y>() += v.m_velocity;
+	}, dependency).schedule().complete();
+
+	for (int i = 0; i < 8; ++i)
+	{
+		position p = std::get<0>(registry.get<position, velocity>(entities[i]));
+		EXPECT_EQ(p.m_x, static_cast<float>(i));
+		EXPECT_EQ(p.m_y, 2.0f);
+	}
+
+	registry.remove<velocity>(entities[0]);
+	position p = std::get<0>(registry.get<position, position>(entities[0]));
+	EXPECT_EQ(p.m_y, 2.0f);
+}
+
+TEST(Test, ForEachChunk)
+{
+	apollo::registry registry(2);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+		registry.emplace<velocity>(e, 1.0f);
+		registry.emplace<position>(e, 0.0f, 0.0f);
+		if (i % 2)
+			registry.emplace<mass>(e, 1.0f);
+	}
+
+	std::size_t rows = 0;
+	std::size_t calls = 0;
+	apollo::job dependency;
+	registry.for_each_chunk([&rows, &calls](apollo::span<const apollo::entity> entities, apollo::span<transform> t, apollo::span<const velocity> v, apollo::soa_span<position> p) {
+		EXPECT_LE(entities.size(), 16u);
+		auto xs = p.get<&position::m_x>();
+		for (std::size_t i = 0; i < entities.size(); ++i)
+		{
+			t[i].m_x += v[i].m_velocity;
+			xs[i] += v[i].m_velocity;
+		}
+		rows += entities.size();
+		++calls;
+	}, dependency, 16).schedule().complete();
+
+	EXPECT_EQ(rows, 100u);
+	EXPECT_EQ(calls, 8u);
+	for (apollo::entity e = 0; e < 100; ++e)
+	{
+		auto [t, p] = registry.get<transform, position>(e);
+		EXPECT_EQ(t.m_x, 1.0f);
+		EXPECT_EQ(position(p).m_x, 1.0f);
+	}
+}
+
+TEST(Test, SortedStorage)
+{
+	apollo::registry registry(2);
+	registry.sort_by_entity<mass>();
+
+	std::vector<apollo::entity> entities;
+	for (int i = 0; i < 200; ++i)
+		entities.push_back(registry.create());
+	for (auto it = entities.rbegin(); it != entities.rend(); ++it)
+		registry.emplace<mass>(*it, static_cast<float>(*it));
+	for (std::size_t i = 0; i < entities.size(); i += 3)
+		registry.destroy(entities[i]);
+
+	apollo::entity previous = 0;
+	bool ordered = true;
+	apollo::job dependency;
+	registry.for_each([&previous, &ordered](apollo::entity& e, mass&) {
+		ordered = ordered && previous <= e;
+		previous = e;
+	}, dependency).schedule().complete();
+	EXPECT_TRUE(ordered);
+
+	auto m = registry.try_get<mass, mass>(entities[1]);
+	ASSERT_TRUE(m.has_value());
+	EXPECT_EQ(std::get<0>(*m).m_mass, static_cast<float>(entities[1]));
+
+	registry.sort_by<mass>([](const mass& lhs, const mass& rhs) {
+		return lhs.m_mass > rhs.m_mass;
+	});
+	float last = 1000.0f;
+	apollo::job descending;
+	registry.for_each([&last, &ordered](apollo::entity&, mass& m) {
+		ordered = ordered && m.m_mass <= last;
+		last = m.m_mass;
+	}, descending).schedule().complete();
+	EXPECT_TRUE(ordered);
+}
+
+TEST(Test, Group)
+{
+	apollo::registry registry(2);
+
+	for (int i = 0; i < 300; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		registry.emplace<velocity>(e, 1.0f);
+		if (i % 2)
+			registry.emplace<mass>(e, 1.0f);
+		if (i % 3)
+			registry.emplace<position>(e, 0.0f, 0.0f);
+	}
+
+	auto& group = registry.group<transform, velocity>();
+	EXPECT_EQ(&group, &(registry.group<transform, velocity>()));
+	EXPECT_EQ(group.get_members().size(), 4u);
+	EXPECT_EQ(group.size(), 300u);
+
+	auto contiguous = [&group]() {
+		const transform* end = nullptr;
+		for (apollo::archetype* member : group.get_members())
+		{
+			auto* transforms = member->get_components<transform>();
+			if (end && transforms->data() != end)
+				return false;
+			end = transforms->data() + transforms->capacity();
+		}
+		return true;
+	};
+	EXPECT_TRUE(contiguous());
+
+	// rows added after packing stay in place, outgrowing the headroom repacks
+	const transform* first = group.get_members()[0]->get_components<transform>()->data();
+	for (int i = 0; i < 10; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+		registry.emplace<velocity>(e, 0.0f);
+	}
+	EXPECT_EQ(group.get_members()[0]->get_components<transform>()->data(), first);
+	EXPECT_TRUE(contiguous());
+	for (int i = 0; i < 200; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+		registry.emplace<velocity>(e, 0.0f);
+	}
+	EXPECT_TRUE(contiguous());
+	for (apollo::entity e = 300; e < 510; ++e)
+		registry.destroy(e);
+
+	for (apollo::entity e = 0; e < 300; e += 5)
+		registry.remove<velocity>(e);
+
+	std::size_t rows = 0;
+	apollo::job dependency;
+	registry.for_each(group, [&rows](apollo::entity&, transform& t, const velocity& v) {
+		t.m_x += v.m_velocity;
+		++rows;
+	}, dependency).schedule().complete();
+	EXPECT_EQ(rows, 240u);
+
+	for (apollo::entity e = 0; e < 300; ++e)
+	{
+		auto t = registry.try_get<transform, transform>(e);
+		ASSERT_TRUE(t.has_value());
+		EXPECT_EQ(std::get<0>(*t).m_x, static_cast<float>(e) + (e % 5 ? 1.0f : 0.0f));
+	}
+}
+
+TEST(Test, TypeId)
+{
+	static_assert(transform::hash == apollo::fnv1a("transform"), "type hash must only depend on the type name");
+	static_assert(apollo::type_list_signature<transform, mass>::collision_free, "test components must not collide");
+	constexpr auto lhs = apollo::type_list_signature<transform, mass>::hashes;
+	constexpr auto rhs = apollo::type_list_signature<mass, transform>::hashes;
+	static_assert(lhs[0] == rhs[0] && lhs[1] == rhs[1], "query signatures must not depend on order");
+	EXPECT_EQ(apollo::type_name<velocity>(), "velocity");
+
+	apollo::registry registry;
+	apollo::entity e = registry.create();
+	registry.emplace<transform>(e, 1.0f, 2.0f, 3.0f);
+	EXPECT_TRUE(registry.has<transform>(e));
+	EXPECT_FALSE(registry.has<mass>(e));
+	EXPECT_FALSE((registry.has<transform, mass>(e)));
+}
+
+TEST(Test, ShardedRegistry)
+{
+	apollo::sharded_registry world(4);
+	std::vector<std::vector<apollo::entity>> entities(world.size());
+	world.parallel([&](apollo::registry& registry, const std::size_t shard) {
+		for (int i = 0; i < 100; ++i)
+		{
+			apollo::entity e = world.create(shard);
+			apollo::entity local = world.locate(e).m_entity;
+			registry.emplace<transform>(local, static_cast<float>(e), 0.0f, 0.0f);
+			if (i % 2)
+				registry.emplace<mass>(local, 1.0f);
+			if (i % 3 == 0)
+				world.migrate(e, (shard + 1) % world.size());
+			entities[shard].push_back(e);
+		}
+	});
+	EXPECT_EQ(world.sync(), 4u * 34u);
+
+	for (std::size_t shard = 0; shard < world.size(); ++shard)
+	{
+		for (std::size_t i = 0; i < entities[shard].size(); ++i)
+		{
+			apollo::entity e = entities[shard][i];
+			apollo::entity_location location = world.locate(e);
+			EXPECT_EQ(location.m_shard, i % 3 ? shard : (shard + 1) % world.size());
+			EXPECT_EQ(world.get_global(location.m_shard, location.m_entity), e);
+			apollo::registry& registry = world.get_shard(location.m_shard);
+			auto t = registry.try_get<transform, transform>(location.m_entity);
+			ASSERT_TRUE(t.has_value());
+			EXPECT_EQ(std::get<0>(*t).m_x, static_cast<float>(e));
+			EXPECT_EQ(registry.has<mass>(location.m_entity), i % 2 == 1);
+		}
+	}
+
+	apollo::entity e = entities[1][1];
+	world.destroy(e);
+	EXPECT_EQ(world.create(1), e);
+
+	// an entity destroyed through its shard after being queued is not migrated
+	apollo::entity queued = entities[2][1];
+	apollo::entity kept = entities[2][2];
+	world.migrate(queued, 3);
+	world.migrate(kept, 3);
+	apollo::entity local = world.locate(queued).m_entity;
+	world.get_shard(2).destroy(local);
+	const std::size_t shard_size = world.get_shard(3).get_entities().size();
+	EXPECT_EQ(world.sync(), 1u);
+	EXPECT_EQ(world.get_shard(3).get_entities().size(), shard_size + 1);
+	EXPECT_EQ(world.locate(kept).m_shard, 3u);
+	EXPECT_EQ(world.locate(queued).m_shard, 2u);
+}
+
+TEST(Test, Index)
+{
+	apollo::registry registry;
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 2)
+			registry.emplace<mass>(e, static_cast<float>(i % 10));
+	}
+
+	auto& by_x = registry.index<apollo::ordered_index<&transform::m_x>>();
+	auto& by_mass = registry.index<apollo::hash_index<&mass::m_mass>>();
+	EXPECT_EQ(&by_x, &(registry.index<apollo::ordered_index<&transform::m_x>>()));
+	EXPECT_EQ(by_x.size(), 100u);
+	EXPECT_EQ(by_mass.size(), 50u);
+	EXPECT_EQ(by_x.find(42.0f), 42u);
+	EXPECT_EQ(by_mass.count(3.0f), 10u);
+	EXPECT_EQ(by_mass.find(4.0f), apollo::invalid_index);
+
+	registry.replace<transform>(42, 1000.0f, 0.0f, 0.0f);
+	EXPECT_EQ(by_x.find(42.0f), apollo::invalid_index);
+	EXPECT_EQ(by_x.find(1000.0f), 42u);
+
+	registry.patch(43, [](transform& t) {
+		t.m_x = -1.0f;
+	});
+	EXPECT_EQ(by_x.begin()->second, 43u);
+
+	registry.remove<mass>(3);
+	EXPECT_EQ(by_mass.count(3.0f), 9u);
+	apollo::entity destroyed = 13;
+	registry.destroy(destroyed);
+	EXPECT_EQ(by_mass.count(3.0f), 8u);
+	EXPECT_EQ(by_x.find(13.0f), apollo::invalid_index);
+
+	apollo::entity e = registry.create();
+	registry.emplace<mass>(e, 3.0f);
+	EXPECT_EQ(by_mass.count(3.0f), 9u);
+
+	auto range = by_x.range(10.0f, 20.0f);
+	std::size_t in_range = std::distance(range.first, range.second);
+	EXPECT_EQ(in_range, 9u);
+	for (auto it = range.first; it != range.second; ++it)
+		EXPECT_TRUE(it->first >= 10.0f && it->first < 20.0f);
+
+	// entries stay erasable after the hash index rehashes many times over
+	auto& by_x_hashed = registry.index<apollo::hash_index<&transform::m_x>>();
+	std::vector<apollo::entity> grown;
+	for (int i = 0; i < 5000; ++i)
+	{
+		grown.push_back(registry.create());
+		registry.emplace<transform>(grown.back(), 10000.0f + i, 0.0f, 0.0f);
+	}
+	for (int i = 0; i < 5000; ++i)
+		registry.replace<transform>(grown[i], -10000.0f - i, 0.0f, 0.0f);
+	EXPECT_EQ(by_x_hashed.size(), by_x.size());
+	EXPECT_EQ(by_x_hashed.find(10000.0f), apollo::invalid_index);
+	EXPECT_EQ(by_x_hashed.find(-14999.0f), grown[4999]);
+	for (std::size_t i = 0; i < grown.size(); i += 2)
+		registry.destroy(grown[i]);
+	EXPECT_EQ(by_x_hashed.size(), by_x.size());
+	EXPECT_EQ(by_x_hashed.count(-10000.0f), 0u);
+	EXPECT_EQ(by_x_hashed.find(-10001.0f), grown[1]);
+
+	// bulk paths index every new row
+	std::vector<apollo::entity> copies;
+	registry.instantiate(grown[1], 1000, copies);
+	EXPECT_EQ(by_x.count(-10001.0f), 1001u);
+	EXPECT_EQ(by_x_hashed.count(-10001.0f), 1001u);
+	EXPECT_EQ(by_x_hashed.size(), by_x.size());
+}
+
+#ifdef APOLLO_ENABLE_COROUTINES
+TEST(Test, AsyncSystem)
+{
+	apollo::registry registry(2);
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+	}
+	auto& system = registry.create_system<phased_system>();
+
+	registry.update();
+	EXPECT_TRUE(system.running());
+	for (int i = 0; i < 10000 && system.running(); ++i)
+	{
+		registry.update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ASSERT_FALSE(system.running());
+	EXPECT_EQ(system.m_runs, 1);
+	EXPECT_EQ(system.m_with_mass, 200u);
+	for (apollo::entity e = 0; e < 100; ++e)
+	{
+		auto components = registry.get<transform, mass>(e);
+		EXPECT_EQ(std::get<0>(components).m_x, 1.0f);
+		EXPECT_EQ(std::get<1>(components).m_mass, 1.0f);
+	}
+
+	// a run suspended on a job or a sync point finishes before the registry goes away
+	for (int frames = 1; frames <= 3; ++frames)
+	{
+		std::atomic<int> in_flight = 0;
+		auto owner = std::make_unique<apollo::registry>(2);
+		for (int i = 0; i < 1000; ++i)
+		{
+			apollo::entity e = owner->create();
+			owner->emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+		}
+		owner->create_system<phased_system>(&in_flight);
+		for (int frame = 0; frame < frames; ++frame)
+			owner->update();
+		owner.reset();
+		EXPECT_EQ(in_flight.load(), 0);
+	}
+}
+#endif
+
+class advance_system : public apollo::system
+{
+public:
+	advance_system(apollo::registry& registry)
+		: apollo::system(registry) {}
+
+	void update() override
+	{
+		for_each([](apollo::entity&, transform& t) {
+			t.m_x += 1.0f;
+		}).schedule();
+	}
+};
+
+class sum_system : public apollo::extract_system
+{
+public:
+	std::vector<std::pair<std::uint64_t, float>> m_frames;
+public:
+	void update(const apollo::world_view& view) override
+	{
+		float sum = 0.0f;
+		view.for_each([&sum](const apollo::entity&, const transform& t) {
+			sum += t.m_x;
+		});
+		m_frames.emplace_back(view.tick(), sum);
+	}
+};
+
+TEST(Test, PipelinedUpdate)
+{
+	apollo::registry registry(2);
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, 0.0f, 0.0f, 0.0f);
+	}
+	registry.create_system<advance_system>();
+	auto& sum = registry.create_extract_system<sum_system>();
+	registry.set_pipeline_depth(3);
+
+	for (int i = 0; i < 20; ++i)
+		registry.update();
+	registry.flush_pipeline();
+
+	ASSERT_EQ(sum.m_frames.size(), 20u);
+	for (std::size_t i = 0; i < sum.m_frames.size(); ++i)
+	{
+		EXPECT_EQ(sum.m_frames[i].first, i);
+		EXPECT_EQ(sum.m_frames[i].second, 100.0f * (i + 1));
+	}
+}
+
+class slow_count_system : public apollo::extract_system
+{
+private:
+	std::atomic<int>& m_frames;
+public:
+	slow_count_system(std::atomic<int>& frames)
+		: m_frames(frames) {}
+
+	void update(const apollo::world_view&) override
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		++m_frames;
+	}
+};
+
+TEST(Test, PipelineFlushOnDestroy)
+{
+	std::atomic<int> frames = 0;
+	{
+		apollo::registry registry(2);
+		registry.emplace<transform>(registry.create(), 0.0f, 0.0f, 0.0f);
+		registry.create_extract_system<slow_count_system>(frames);
+		registry.set_pipeline_depth(4);
+		for (int i = 0; i < 10; ++i)
+			registry.update();
+	}
+	EXPECT_EQ(frames.load(), 10);
+}
+
+TEST(Test, BulkDestroyRemove)
+{
+	apollo::registry registry;
+	for (int i = 0; i < 1000; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 2)
+			registry.emplace<mass>(e, static_cast<float>(i));
+		if (i % 3 == 0)
+			registry.emplace<velocity>(e, 1.0f);
+	}
+
+	std::size_t batches = 0;
+	std::size_t notified = 0;
+	registry.on_destroy<velocity>().connect_batch([&](apollo::registry&, apollo::span<const apollo::entity> entities) {
+		++batches;
+		notified += entities.size();
+	});
+
+	EXPECT_EQ(registry.remove_all<velocity>(), 334u);
+	EXPECT_EQ(notified, 334u);
+	EXPECT_EQ(batches, 2u);
+	EXPECT_FALSE(registry.has<velocity>(3));
+	EXPECT_TRUE((registry.has<transform, mass>(3)));
+
+	EXPECT_EQ(registry.remove_if<mass>([](const apollo::entity&, const mass& m) {
+		return m.m_mass < 100.0f;
+	}), 50u);
+	EXPECT_FALSE(registry.has<mass>(99));
+	EXPECT_TRUE(registry.has<mass>(101));
+
+	auto& by_x = registry.index<apollo::hash_index<&transform::m_x>>();
+	EXPECT_EQ(registry.destroy_if([](const apollo::entity&, const transform& t) {
+		return t.m_x >= 500.0f;
+	}), 500u);
+	EXPECT_EQ(by_x.size(), 500u);
+	EXPECT_EQ(by_x.find(700.0f), apollo::invalid_index);
+	EXPECT_EQ(by_x.find(300.0f), 300u);
+
+	EXPECT_EQ(registry.destroy_all<mass>(), 200u);
+	EXPECT_EQ(by_x.size(), 300u);
+	std::vector<apollo::entity> alive = registry.get_entities();
+	ASSERT_EQ(alive.size(), 300u);
+	for (apollo::entity e : alive)
+	{
+		EXPECT_TRUE(e < 100 || e % 2 == 0);
+		EXPECT_EQ(std::get<0>(registry.get<transform, transform>(e)).m_x, static_cast<float>(e));
+	}
+
+	registry.clear();
+	EXPECT_EQ(by_x.size(), 0u);
+	apollo::entity e = registry.create();
+	EXPECT_LT(e, 1000u);
+}
+
+TEST(Test, CommandPlayback)
+{
+	apollo::registry batched;
+	apollo::registry serial;
+	std::size_t notified[2][3] = {};
+	std::vector<apollo::entity> entities;
+	for (int r = 0; r < 2; ++r)
+	{
+		apollo::registry& registry = r ? serial : batched;
+		for (int i = 0; i < 1000; ++i)
+		{
+			apollo::entity e = registry.create();
+			registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+			if (i % 2)
+				registry.emplace<mass>(e, static_cast<float>(i));
+			if (i % 3 == 0)
+				registry.emplace<velocity>(e, 1.0f);
+			if (r == 0)
+				entities.push_back(e);
+		}
+		registry.on_destroy<transform>().connect([&notified, r](apollo::registry&, const apollo::entity&) {
+			++notified[r][0];
+		});
+		registry.on_destroy<mass>().connect([&notified, r](apollo::registry&, const apollo::entity&) {
+			++notified[r][1];
+		});
+		registry.on_destroy<velocity>().connect([&notified, r](apollo::registry&, const apollo::entity&) {
+			++notified[r][2];
+		});
+	}
+	auto& by_x = batched.index<apollo::hash_index<&transform::m_x>>();
+
+	std::vector<apollo::entity> targets = entities;
+	auto fill = [&targets](apollo::command_buffer& buffer) {
+		for (auto& e : targets)
+		{
+			if (e % 3 == 0)
+				buffer.add_command<apollo::remove_command<velocity>>(e);
+			if (e % 7 == 0)
+				buffer.add_command<apollo::remove_command<mass>>(e);
+		}
+		for (auto& e : targets)
+		{
+			if (e % 5 == 0)
+				buffer.add_command<apollo::destroy_command>(e);
+		}
+	};
+	apollo::command_buffer batched_buffer = batched.create_command_buffer();
+	apollo::command_buffer serial_buffer = serial.create_command_buffer();
+	fill(batched_buffer);
+	fill(serial_buffer);
+	batched.execute(batched_buffer);
+	serial_buffer.execute();
+
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ(notified[0][i], notified[1][i]);
+	EXPECT_EQ(notified[0][0], 200u);
+	EXPECT_EQ(by_x.size(), 800u);
+	EXPECT_EQ(by_x.find(15.0f), apollo::invalid_index);
+
+	std::vector<apollo::entity> alive = batched.get_entities();
+	std::sort(alive.begin(), alive.end());
+	std::vector<apollo::entity> expected = serial.get_entities();
+	std::sort(expected.begin(), expected.end());
+	ASSERT_EQ(alive, expected);
+	for (apollo::entity e : entities)
+	{
+		ASSERT_EQ(batched.valid(e), serial.valid(e));
+		if (!batched.valid(e))
+		{
+			EXPECT_EQ(by_x.find(static_cast<float>(e)), apollo::invalid_index);
+			continue;
+		}
+		EXPECT_EQ(batched.has<mass>(e), serial.has<mass>(e));
+		EXPECT_EQ(batched.has<velocity>(e), serial.has<velocity>(e));
+		EXPECT_EQ(std::get<0>(batched.get<transform, transform>(e)).m_x, std::get<0>(serial.get<transform, transform>(e)).m_x);
+		EXPECT_EQ(by_x.find(static_cast<float>(e)), e);
+		if (batched.has<mass>(e))
+		{
+			EXPECT_EQ(std::get<0>(batched.get<mass, mass>(e)).m_mass, std::get<0>(serial.get<mass, mass>(e)).m_mass);
+		}
+	}
+
+	// both registries end up with the same rows per component set
+	auto layout = [](const apollo::registry& registry) {
+		std::vector<std::pair<std::vector<apollo::id_type>, std::size_t>> result;
+		for (const auto& a : registry.stats().m_archetypes)
+		{
+			if (!a.m_num_entities)
+				continue;
+			std::vector<apollo::id_type> signature;
+			for (const auto& c : a.m_columns)
+				signature.push_back(c.m_component_id);
+			std::sort(signature.begin(), signature.end());
+			result.emplace_back(std::move(signature), a.m_num_entities);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+	EXPECT_EQ(layout(batched), layout(serial));
+	EXPECT_EQ(batched.create(), serial.create());
+}
+
+TEST(Test, Prefab)
+{
+	apollo::registry registry;
+	std::size_t constructed = 0;
+	registry.on_construct<mass>().connect_batch([&constructed](apollo::registry&, apollo::span<const apollo::entity> entities) {
+		constructed += entities.size();
+	});
+
+	apollo::prefab<transform, mass, position> unit(transform(1.0f, 2.0f, 3.0f), mass(5.0f), position(7.0f, 8.0f));
+	std::vector<apollo::entity> units;
+	registry.instantiate(unit, 1000, units);
+	ASSERT_EQ(units.size(), 1000u);
+	EXPECT_EQ(constructed, 1000u);
+	for (apollo::entity e : units)
+	{
+		auto components = registry.get<transform, mass, position>(e);
+		EXPECT_EQ(std::get<0>(components).m_z, 3.0f);
+		EXPECT_EQ(std::get<1>(components).m_mass, 5.0f);
+		EXPECT_EQ(static_cast<position>(std::get<2>(components)).m_y, 8.0f);
+	}
+
+	registry.replace<mass>(units[10], 9.0f);
+	apollo::entity copy = registry.clone(units[10]);
+	EXPECT_EQ(std::get<0>(registry.get<mass, mass>(copy)).m_mass, 9.0f);
+	EXPECT_EQ(constructed, 1001u);
+
+	std::vector<apollo::entity> copies;
+	registry.instantiate(copy, 10, copies);
+	for (apollo::entity e : copies)
+	{
+		EXPECT_TRUE((registry.has<transform, mass, position>(e)));
+		EXPECT_EQ(std::get<0>(registry.get<mass, mass>(e)).m_mass, 9.0f);
+	}
+
+	apollo::entity single = registry.instantiate(apollo::prefab<velocity>(velocity(2.0f)));
+	EXPECT_EQ(std::get<0>(registry.get<velocity, velocity>(single)).m_velocity, 2.0f);
+	EXPECT_FALSE(registry.has<transform>(single));
+}
+
+class mass_watch_system : public apollo::reactive_system<transform, mass>
+{
+public:
+	std::vector<std::vector<apollo::entity>> m_runs;
+public:
+	mass_watch_system(apollo::registry& registry)
+		: apollo::reactive_system<transform, mass>(registry) {}
+
+	void react(apollo::span<const apollo::entity> entities) override
+	{
+		m_runs.emplace_back(entities.begin(), entities.end());
+	}
+};
+
+TEST(Test, ReactiveSystem)
+{
+	apollo::registry registry;
+	const mass_watch_system& watch = registry.create_system<mass_watch_system>();
+	auto& moved = registry.create_reactive<transform>();
+	std::vector<apollo::entity> entities;
+	for (int i = 0; i < 100; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 2 == 0)
+			registry.emplace<mass>(e, 1.0f);
+		entities.push_back(e);
+	}
+	EXPECT_EQ(moved.collect().size(), 100u);
+	EXPECT_TRUE(moved.collect().empty());
+
+	registry.update();
+	ASSERT_EQ(watch.m_runs.size(), 1u);
+	EXPECT_EQ(watch.m_runs[0].size(), 50u);
+	registry.update();
+	EXPECT_EQ(watch.m_runs.size(), 1u);
+
+	registry.replace<mass>(entities[2], 2.0f);
+	registry.replace<mass>(entities[2], 3.0f);
+	registry.patch(entities[4], [](mass& m) {
+		m.m_mass = 4.0f;
+	});
+	registry.emplace<mass>(entities[9], 1.0f);
+	registry.replace<mass>(entities[6], 2.0f);
+	registry.remove<mass>(entities[6]);
+	registry.replace<mass>(entities[8], 2.0f);
+	registry.destroy(entities[8]);
+	registry.replace<transform>(entities[10], 1.0f, 1.0f, 1.0f);
+	registry.replace<transform>(entities[11], 1.0f, 1.0f, 1.0f);
+	registry.update();
+	ASSERT_EQ(watch.m_runs.size(), 2u);
+	EXPECT_EQ(watch.m_runs[1], (std::vector<apollo::entity>{ 2, 4, 9, 10 }));
+	EXPECT_EQ(moved.collect().size(), 2u);
+
+	EXPECT_FALSE(registry.valid(entities[8]));
+	EXPECT_TRUE(registry.valid(entities[6]));
+	EXPECT_FALSE(registry.valid(1000));
+}
+
+TEST(Test, View)
+{
+	apollo::registry registry;
+	for (int i = 0; i < 300; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 3 == 0)
+			registry.emplace<velocity>(e, static_cast<float>(i));
+		if (i % 5 == 0)
+			registry.emplace<position>(e, static_cast<float>(i), 0.0f);
+	}
+
+	auto moving = registry.view<transform, velocity>();
+	EXPECT_EQ(moving.size_hint(), 100u);
+	std::size_t count = 0;
+	for (auto [e, t, v] : moving)
+	{
+		EXPECT_EQ(t.m_x, static_cast<float>(e));
+		EXPECT_EQ(v.m_velocity, static_cast<float>(e));
+		t.m_y = v.m_velocity;
+		++count;
+	}
+	EXPECT_EQ(count, 100u);
+	EXPECT_EQ(std::distance(moving.begin(), moving.end()), 100);
+	EXPECT_EQ((std::get<0>(registry.get<transform, transform>(9)).m_y), 9.0f);
+
+	for (auto [e, p] : registry.view<position>())
+		p.get<&position::m_y>() = 1.0f;
+	position p = std::get<0>(registry.get<position, position>(10));
+	EXPECT_EQ(p.m_y, 1.0f);
+	EXPECT_EQ((registry.view<position, velocity>().size_hint()), 20u);
+
+	std::vector<apollo::entity> expected;
+	for (auto [e, t, v] : moving)
+		expected.push_back(e);
+	std::vector<apollo::entity> parts;
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		auto part = moving.split(3, i);
+		EXPECT_EQ(part.size_hint(), (i + 1) * 100 / 3 - i * 100 / 3);
+		for (auto [e, t, v] : part)
+			parts.push_back(e);
+	}
+	EXPECT_EQ(parts, expected);
+	EXPECT_EQ(std::get<0>(*(moving.begin() + 57)), expected[57]);
+	EXPECT_TRUE(moving.subview(100, 200).empty());
+	EXPECT_TRUE(registry.view<mass>().empty());
+	EXPECT_EQ((registry.get_entities<transform, velocity>().size()), 100u);
+
+	const apollo::registry& readonly = registry;
+	float sum = 0.0f;
+	for (auto [e, t, p] : readonly.view<transform, position>())
+	{
+		static_assert(std::is_same<decltype(t), const transform&>::value, "const views yield const references");
+		static_assert(std::is_same<decltype(p), position>::value, "const views yield SoA components by value");
+		sum += t.m_x + p.m_y;
+	}
+	EXPECT_EQ(sum, 8850.0f + 60.0f);
+
+	// writes through a view are stamped and reach deltas, reads through a const one are not
+	apollo::registry source(1);
+	apollo::registry replica(1);
+	for (int i = 0; i < 300; ++i)
+	{
+		apollo::entity e = source.create();
+		source.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 3 == 0)
+			source.emplace<velocity>(e, 1.0f);
+	}
+	std::vector<std::byte> buffer;
+	ASSERT_TRUE(source.save_delta(buffer, 0));
+	ASSERT_TRUE((replica.apply_delta<transform, velocity>(buffer)));
+	source.update();
+	const std::uint64_t since = source.tick();
+	std::vector<std::byte> unchanged;
+	ASSERT_TRUE(source.save_delta(unchanged, since));
+
+	const apollo::registry& reader = source;
+	std::size_t read = 0;
+	for (auto [e, t] : reader.view<transform>())
+		read += t.m_x >= 0.0f;
+	EXPECT_EQ(read, 300u);
+	buffer.clear();
+	ASSERT_TRUE(source.save_delta(buffer, since));
+	EXPECT_EQ(buffer.size(), unchanged.size());
+
+	for (auto [e, t, v] : source.view<transform, velocity>())
+		t.m_z = 7.0f;
+	buffer.clear();
+	ASSERT_TRUE(source.save_delta(buffer, since));
+	EXPECT_GT(buffer.size(), unchanged.size());
+	ASSERT_TRUE((replica.apply_delta<transform, velocity>(buffer)));
+	EXPECT_EQ((std::get<0>(replica.get<transform, transform>(9)).m_z), 7.0f);
+	EXPECT_EQ((std::get<0>(replica.get<transform, transform>(10)).m_z), 0.0f);
+
+	// sorted archetypes are merged before a view walks them
+	apollo::registry sorted(1);
+	sorted.sort_by_entity<mass>();
+	std::vector<apollo::entity> created;
+	for (int i = 0; i < 40; ++i)
+		created.push_back(sorted.create());
+	for (auto it = created.rbegin(); it != created.rend(); ++it)
+		sorted.emplace<mass>(*it, 1.0f);
+	apollo::entity previous = 0;
+	bool ordered = true;
+	for (auto [e, m] : sorted.view<mass>())
+	{
+		ordered = ordered && previous <= e;
+		previous = e;
+	}
+	EXPECT_TRUE(ordered);
+}
+
+TEST(Test, Reduce)
+{
+	apollo::registry registry(4);
+	apollo::registry single(1);
+	for (apollo::registry* r : { &registry, &single })
+	{
+		for (int i = 0; i < 20000; ++i)
+		{
+			apollo::entity e = r->create();
+			r->emplace<mass>(e, 0.1f * static_cast<float>(i % 1000));
+			if (i % 4 == 0)
+				r->emplace<transform>(e, static_cast<float>(i), -static_cast<float>(i), 0.0f);
+		}
+	}
+
+	const double total = registry.transform_reduce(0.0, [](const apollo::entity&, const mass&) {
+		return 1.0;
+	}, [](const double lhs, const double rhs) {
+		return lhs + rhs;
+	}, apollo::reduce_order::fast, 256);
+	EXPECT_EQ(total, 20000.0);
+
+	struct bounds
+	{
+		float m_min;
+		float m_max;
+	};
+	const bounds box = registry.reduce(bounds{ std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() }, [](bounds& b, const apollo::entity&, const transform& t) {
+		b.m_min = std::min(b.m_min, t.m_y);
+		b.m_max = std::max(b.m_max, t.m_x);
+	}, [](bounds& b, const bounds& other) {
+		b.m_min = std::min(b.m_min, other.m_min);
+		b.m_max = std::max(b.m_max, other.m_max);
+	}, apollo::reduce_order::fast, 100);
+	EXPECT_EQ(box.m_min, -19996.0f);
+	EXPECT_EQ(box.m_max, 19996.0f);
+
+	const std::vector<int> histogram = registry.reduce(std::vector<int>(10), [](std::vector<int>& h, const apollo::entity&, const mass& m) {
+		++h[static_cast<std::size_t>(m.m_mass) / 10];
+	}, [](std::vector<int>& h, const std::vector<int>& other) {
+		for (std::size_t i = 0; i < h.size(); ++i)
+			h[i] += other[i];
+	});
+	EXPECT_EQ(histogram, std::vector<int>(10, 2000));
+
+	auto sum = [](apollo::registry& r) {
+		return r.transform_reduce(0.0f, [](const apollo::entity&, const mass& m) {
+			return m.m_mass;
+		}, [](const float lhs, const float rhs) {
+			return lhs + rhs;
+		}, apollo::reduce_order::deterministic, 128);
+	};
+	const float expected = sum(single);
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(sum(registry), expected);
+	EXPECT_EQ(registry.transform_reduce(7, [](const apollo::entity&, const velocity&) {
+		return 1;
+	}, [](const int lhs, const int rhs) {
+		return lhs + rhs;
+	}), 7);
+}
+
+TEST(Test, ColdArchetypes)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "apollo_cold.bin";
+	std::unique_ptr<apollo::registry> owner = std::make_unique<apollo::registry>();
+	apollo::registry& registry = *owner;
+	for (int i = 0; i < 300; ++i)
+	{
+		apollo::entity e = registry.create();
+		registry.emplace<transform>(e, static_cast<float>(i), 0.0f, 0.0f);
+		if (i % 3 == 0)
+			registry.emplace<velocity>(e, static_cast<float>(i));
+		if (i % 5 == 0)
+			registry.emplace<position>(e, static_cast<float>(i), 2.0f);
+	}
+	EXPECT_EQ(registry.freeze<velocity>(), 0u);
+	ASSERT_TRUE(registry.set_cold_store(path.string()));
+	EXPECT_EQ(registry.freeze<velocity>(), 100u);
+	EXPECT_GT(registry.cold_size(), 0u);
+	EXPECT_TRUE(registry.is_cold(3));
+	EXPECT_TRUE(registry.is_cold(15));
+	EXPECT_FALSE(registry.is_cold(1));
+
+	std::atomic<int> visited = 0;
+	apollo::job dependency;
+	registry.for_each([&visited](apollo::entity& e, transform&) {
+		EXPECT_NE(e % 3, 0u);
+		++visited;
+	}, dependency).schedule().complete();
+	EXPECT_EQ(visited.load(), 200);
+	EXPECT_EQ(registry.view<transform>().size_hint(), 200u);
+	EXPECT_TRUE((registry.view<transform, velocity>().empty()));
+	EXPECT_EQ(registry.get_entities<transform>().size(), 200u);
+	EXPECT_EQ(registry.transform_reduce(0, [](const apollo::entity&, const transform&) {
+		return 1;
+	}, [](const int lhs, const int rhs) {
+		return lhs + rhs;
+	}), 200);
+
+	// touching one entity pages its archetype back in
+	EXPECT_EQ((std::get<0>(registry.get<transform, transform>(3)).m_x), 3.0f);
+	EXPECT_FALSE(registry.is_cold(3));
+	EXPECT_FALSE(registry.is_cold(6));
+	EXPECT_TRUE(registry.is_cold(15));
+	position p = std::get<0>(registry.get<position, position>(15));
+	EXPECT_EQ(p.m_x, 15.0f);
+	EXPECT_EQ(p.m_y, 2.0f);
+	EXPECT_EQ(registry.cold_size(), 0u);
+	EXPECT_EQ(registry.view<transform>().size_hint(), 300u);
+
+	EXPECT_EQ(registry.freeze<velocity>(), 100u);
+	registry.emplace<velocity>(1, 1.0f);
+	EXPECT_FALSE(registry.is_cold(1));
+	EXPECT_FALSE(registry.is_cold(6));
+	EXPECT_EQ((std::get<1>(registry.get<transform, velocity>(6)).m_velocity), 6.0f);
+	EXPECT_TRUE(registry.is_cold(30));
+	EXPECT_EQ(registry.wake<position>(), 20u);
+	EXPECT_EQ((registry.view<transform, velocity>().size_hint()), 101u);
+
+	EXPECT_EQ(registry.freeze<velocity>(), 101u);
+	EXPECT_EQ(registry.destroy_all<velocity>(), 101u);
+	EXPECT_EQ(registry.cold_size(), 0u);
+	EXPECT_EQ(registry.get_entities().size(), 199u);
+	EXPECT_EQ(registry.view<transform>().size_hint(), 199u);
+
+	// predicates see cold rows, which pages their archetypes in
+	EXPECT_EQ(registry.freeze<position>(), 40u);
+	EXPECT_EQ(registry.destroy_if([](const apollo::entity&, const position& p) {
+		return p.m_x < 100.0f;
+	}), 13u);
+	EXPECT_EQ(registry.cold_size(), 0u);
+	EXPECT_EQ(registry.freeze<position>(), 27u);
+	EXPECT_EQ(registry.remove_if<position>([](const apollo::entity&, const transform& t) {
+		return t.m_x >= 200.0f;
+	}), 14u);
+	EXPECT_EQ(registry.cold_size(), 0u);
+	EXPECT_EQ(registry.view<position>().size_hint(), 13u);
+
+	owner.reset();
+	std::filesystem::remove(path);
+	EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(Test, JobPriority)
+{
+	apollo::thread_pool pool(1);
+	std::atomic<bool> opened = false;
+	std::atomic<bool> release = false;
+	auto gate = pool.enqueue([&opened, &release]() {
+		opened = true;
+		while (!release.load())
+			std::this_thread::yield();
+	});
+	while (!opened.load())
+		std::this_thread::yield();
+	std::mutex mutex;
+	std::vector<int> order;
+	auto record = [&mutex, &order](int value) {
+		std::lock_guard<std::mutex> lock(mutex);
+		order.push_back(value);
+	};
+	auto background = pool.enqueue(apollo::job_priority::background, record, 2);
+	auto normal = pool.enqueue(record, 1);
+	auto critical = pool.enqueue(apollo::job_priority::critical, record, 0);
+	release = true;
+	gate.wait();
+	background.wait();
+	normal.wait();
+	critical.wait();
+	EXPECT_EQ(order, (std::vector<int>{ 0, 1, 2 }));
+
+	// a running background job lets higher lanes in at its chunk boundaries
+	apollo::registry registry(1);
+	std::atomic<bool> started = false;
+	std::atomic<bool> queued = false;
+	std::atomic<bool> done = false;
+	bool preempted = false;
+	apollo::job slow = registry.create_job([&]() {
+		started = true;
+		while (!queued.load())
+			std::this_thread::yield();
+		for (int chunk = 0; chunk < 4; ++chunk)
+			registry.preempt();
+		preempted = done.load();
+	});
+	apollo::job_handle slow_handle = slow.schedule(apollo::job_priority::background);
+	while (!started.load())
+		std::this_thread::yield();
+	apollo::job urgent = registry.create_job([&done]() {
+		done = true;
+	});
+	apollo::job_handle urgent_handle = urgent.schedule(apollo::job_priority::critical);
+	queued = true;
+	slow_handle.complete();
+	urgent_handle.complete();
+	EXPECT_TRUE(preempted);
+	EXPECT_FALSE(registry.preempt());
+
+	// preempting another pool from a task is a no-op
+	apollo::thread_pool idle(0);
+	auto foreign = idle.enqueue(apollo::job_priority::critical, []() {});
+	auto crossing = pool.enqueue(apollo::job_priority::background, [&idle]() {
+		return idle.preempt();
+	});
+	EXPECT_FALSE(crossing.get());
+	EXPECT_EQ(foreign.wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+}
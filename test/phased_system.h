@@ -0,0 +1,56 @@
+#ifndef TEST_PHASED_SYSTEM_H
+#define TEST_PHASED_SYSTEM_H
+
+#ifdef APOLLO_ENABLE_COROUTINES
+
+#include <apollo/async_system.h>
+#include <atomic>
+#include "transform.h"
+#include "mass.h"
+
+// query, wait, structural change, query again
+class phased_system : public apollo::async_system
+{
+public:
+	std::atomic<int> m_runs{ 0 };
+	std::atomic<std::size_t> m_with_mass{ 0 };
+	// runs started and not yet finished, readable past the system's lifetime
+	std::atomic<int>* m_in_flight = nullptr;
+public:
+	phased_system(apollo::registry& registry, std::atomic<int>* in_flight = nullptr)
+		: apollo::async_system(registry), m_in_flight(in_flight) {}
+
+	apollo::task run() override
+	{
+		if (m_in_flight)
+			++*m_in_flight;
+		co_await for_each([](apollo::entity&, transform& t) {
+			t.m_x += 1.0f;
+		});
+
+		co_await next_sync_point();
+		for (apollo::entity e : m_registry.get_entities())
+		{
+			if (!m_registry.has<mass>(e))
+				m_registry.emplace<mass>(e, 1.0f);
+		}
+
+		std::atomic<std::size_t> count{ 0 };
+		apollo::job none;
+		apollo::job first = m_registry.for_each([&count](apollo::entity&, const mass&) {
+			++count;
+		}, none);
+		apollo::job second = m_registry.for_each([&count](apollo::entity&, const transform&) {
+			++count;
+		}, none);
+		co_await apollo::when_all(first, second);
+		m_with_mass = count.load();
+		++m_runs;
+		if (m_in_flight)
+			--*m_in_flight;
+	}
+};
+
+#endif // APOLLO_ENABLE_COROUTINES
+
+#endif // !TEST_PHASED_SYSTEM_H
@@ -0,0 +1,24 @@
+#ifndef TEST_POSITION_H
+#define TEST_POSITION_H
+
+#include <apollo/component.h>
+#include <apollo/soa.h>
+
+struct position : public apollo::component<position>
+{
+	float m_x;
+	float m_y;
+
+	position() = default;
+
+	position(float x, float y)
+		: m_x(x), m_y(y)
+	{}
+};
+
+template <>
+struct apollo::soa_layout<position> : apollo::soa_fields<&position::m_x, &position::m_y>
+{
+};
+
+#endif // !TEST_POSITION_H